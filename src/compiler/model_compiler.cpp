@@ -0,0 +1,214 @@
+#include "model_compiler.h"
+
+#include <fstream>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace NeuralNetwork::Compiler
+{
+    template<typename T>
+    ModelCompiler<T>::ModelCompiler(const Perceptron<T>& perceptron, Activation activation, int unrollLimit) :
+        ModelCompiler(perceptron, std::vector<Activation>(perceptron.GetNeuronsCountPerLayer().size() - 1, activation), unrollLimit)
+    {
+    }
+
+    //
+    // @activationPerLayer contains activation of every layer except the input one.
+    //
+    template<typename T>
+    ModelCompiler<T>::ModelCompiler(const Perceptron<T>& perceptron, const std::vector<Activation>& activationPerLayer, int unrollLimit) :
+        _neuronsCountPerLayer(perceptron.GetNeuronsCountPerLayer()),
+        _activations(activationPerLayer),
+        _unrollLimit(unrollLimit)
+    {
+        if (_neuronsCountPerLayer.size() < 2)
+            throw std::invalid_argument("Perceptron must have at least two layers");
+
+        if (activationPerLayer.size() != _neuronsCountPerLayer.size() - 1)
+            throw std::invalid_argument("Activations count must be equal layers count without the input layer");
+
+        for (int i = 0; i < _neuronsCountPerLayer.size() - 1; i++)
+        {
+            _weights.push_back(perceptron.GetWeights(i));
+            _bias.push_back(perceptron.GetBias(i));
+        }
+    }
+
+    template<typename T>
+    void ModelCompiler<T>::Emit(std::ostream& stream, const std::string& namespaceName) const
+    {
+        const char* type = GetTypeName();
+        int layersCount = _neuronsCountPerLayer.size();
+
+        stream << "//\n// Generated by NeuralNetwork model compiler, do not edit.\n//\n\n";
+        stream << "#pragma once\n\n#include <cmath>\n\n";
+        stream << "namespace " << namespaceName << "\n{\n";
+
+        stream << "    using Value = " << type << ";\n\n";
+        stream << "    constexpr int LayersCount = " << layersCount << ";\n";
+        stream << "    constexpr int NeuronsCountPerLayer[LayersCount] = { ";
+        for (int i = 0; i < layersCount; i++)
+        {
+            stream << (i > 0 ? ", " : "") << _neuronsCountPerLayer[i];
+        }
+        stream << " };\n";
+        stream << "    constexpr int InputsCount = " << _neuronsCountPerLayer.front() << ";\n";
+        stream << "    constexpr int OutputsCount = " << _neuronsCountPerLayer.back() << ";\n\n";
+
+        stream << "    namespace Detail\n    {\n";
+        stream << "        inline Value Linear(Value x) { return x; }\n";
+        stream << "        inline Value BinaryStep(Value x) { return x < Value(0) ? Value(0) : Value(1); }\n";
+        // Math::Functions evaluates exp() in double precision, so do the generated functions
+        stream << "        inline Value Sigmoid(Value x) { return Value(1) / (Value(1) + std::exp(double(-x))); }\n";
+        stream << "        inline Value HyperbolicTangent(Value x) { Value ex = std::exp(double(x)); Value emx = std::exp(double(-x)); return (ex - emx) / (ex + emx); }\n";
+        stream << "        inline Value ReLU(Value x) { return x < Value(0) ? Value(0) : x; }\n";
+
+        for (int i = 0; i < _weights.size(); i++)
+        {
+            const Math::Matrix<T>& weights = _weights[i];
+            if (weights.GetRows() * weights.GetCols() <= _unrollLimit)
+                continue;
+
+            stream << "\n        alignas(64) constexpr Value Weights" << i << "[" << weights.GetRows() << "][" << weights.GetCols() << "] =\n        {\n";
+            for (int row = 0; row < weights.GetRows(); row++)
+            {
+                stream << "            { ";
+                for (int col = 0; col < weights.GetCols(); col++)
+                {
+                    stream << (col > 0 ? ", " : "") << FormatValue(weights(row, col));
+                }
+                stream << " },\n";
+            }
+            stream << "        };\n";
+
+            stream << "        alignas(64) constexpr Value Bias" << i << "[" << weights.GetRows() << "] = { ";
+            for (int row = 0; row < weights.GetRows(); row++)
+            {
+                stream << (row > 0 ? ", " : "") << FormatValue(_bias[i](row, 0));
+            }
+            stream << " };\n";
+        }
+        stream << "    }\n\n";
+
+        stream << "    //\n    // Computes @output[OutputsCount] for @input[InputsCount].\n    //\n";
+        stream << "    inline void Predict(const Value* input, Value* output)\n    {\n";
+        for (int i = 1; i < layersCount - 1; i++)
+        {
+            stream << "        Value layer" << i << "[" << _neuronsCountPerLayer[i] << "];\n";
+        }
+        if (layersCount > 2)
+            stream << "\n";
+
+        for (int i = 0; i < _weights.size(); i++)
+        {
+            std::string input = i == 0 ? "input" : "layer" + std::to_string(i);
+            std::string output = i == _weights.size() - 1 ? "output" : "layer" + std::to_string(i + 1);
+            EmitLayer(stream, i, input, output);
+        }
+        stream << "    }\n}\n";
+
+        if (!stream)
+            throw std::runtime_error("Failed to write generated code");
+    }
+
+    template<typename T>
+    void ModelCompiler<T>::EmitToFile(const std::string& path, const std::string& namespaceName) const
+    {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file)
+            throw std::runtime_error("Failed to open file " + path);
+
+        Emit(file, namespaceName);
+    }
+
+    template<typename T>
+    Activation ModelCompiler<T>::ParseActivation(const std::string& name)
+    {
+        for (Activation activation : { Activation::Linear, Activation::BinaryStep, Activation::Sigmoid, Activation::HyperbolicTangent, Activation::ReLU })
+        {
+            if (name == GetActivationName(activation))
+                return activation;
+        }
+        throw std::invalid_argument("Unknown activation function " + name);
+    }
+
+    template<typename T>
+    const char* ModelCompiler<T>::GetActivationName(Activation activation)
+    {
+        switch (activation)
+        {
+        case Activation::Linear:
+            return "Linear";
+        case Activation::BinaryStep:
+            return "BinaryStep";
+        case Activation::Sigmoid:
+            return "Sigmoid";
+        case Activation::HyperbolicTangent:
+            return "HyperbolicTangent";
+        case Activation::ReLU:
+            return "ReLU";
+        }
+        throw std::invalid_argument("Unknown activation function");
+    }
+
+    //
+    // Sums are accumulated in the same order as Math::Matrix::MultAndStoreThis() does, bias is added last.
+    //
+    template<typename T>
+    void ModelCompiler<T>::EmitLayer(std::ostream& stream, int layerIndex, const std::string& input, const std::string& output) const
+    {
+        const Math::Matrix<T>& weights = _weights[layerIndex];
+        std::string activation = std::string("Detail::") + GetActivationName(_activations[layerIndex]);
+
+        stream << "        // Layer " << layerIndex + 1 << ": " << weights.GetRows() << " x " << weights.GetCols() << ", "
+            << GetActivationName(_activations[layerIndex]) << "\n";
+
+        if (weights.GetRows() * weights.GetCols() > _unrollLimit)
+        {
+            std::string index = std::to_string(layerIndex);
+            stream << "        for (int row = 0; row < " << weights.GetRows() << "; row++)\n        {\n";
+            stream << "            Value sum = Value(0);\n";
+            stream << "            for (int col = 0; col < " << weights.GetCols() << "; col++)\n            {\n";
+            stream << "                sum += Detail::Weights" << index << "[row][col] * " << input << "[col];\n            }\n";
+            stream << "            " << output << "[row] = " << activation << "(sum + Detail::Bias" << index << "[row]);\n        }\n\n";
+            return;
+        }
+
+        for (int row = 0; row < weights.GetRows(); row++)
+        {
+            stream << "        " << output << "[" << row << "] = " << activation << "(";
+            bool isEmpty = true;
+            for (int col = 0; col < weights.GetCols(); col++)
+            {
+                if (weights(row, col) == static_cast<T>(0.0))
+                    continue;
+
+                stream << (isEmpty ? "" : " + ") << FormatValue(weights(row, col)) << " * " << input << "[" << col << "]";
+                isEmpty = false;
+            }
+            stream << (isEmpty ? "" : " + ") << FormatValue(_bias[layerIndex](row, 0)) << ");\n";
+        }
+        stream << "\n";
+    }
+
+    template<typename T>
+    std::string ModelCompiler<T>::FormatValue(T value)
+    {
+        if (!std::isfinite(value))
+            throw std::invalid_argument("Weights must be finite");
+
+        std::ostringstream stream;
+        stream << std::hexfloat << value << (sizeof(T) == sizeof(float) ? "f" : "");
+        return stream.str();
+    }
+
+    template<typename T>
+    const char* ModelCompiler<T>::GetTypeName()
+    {
+        return sizeof(T) == sizeof(float) ? "float" : "double";
+    }
+
+    template class ModelCompiler<float>;
+    template class ModelCompiler<double>;
+}
\ No newline at end of file
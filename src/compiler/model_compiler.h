@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <iostream>
+
+#include "perceptron.h"
+
+namespace NeuralNetwork::Compiler
+{
+    //
+    // Activation functions supported by generated code, the same formulas as in Math::Functions.
+    //
+    enum class Activation
+    {
+        Linear,
+        BinaryStep,
+        Sigmoid,
+        HyperbolicTangent,
+        ReLU
+    };
+
+    //
+    // Emits a standalone header with inference of a trained perceptron: shapes are constexpr, weights are embedded
+    //      and layers are unrolled to straight-line code with weights as literals (zero weights are dropped).
+    // Layers with more than @unrollLimit weights are emitted as loops with constant bounds over constexpr arrays,
+    //      so the size of generated code stays reasonable. Values are written as hexadecimal floating point literals,
+    //      the generated function reproduces ForwardPropagation() bit for bit when compiled without FMA contraction.
+    // The generated header depends only on <cmath>.
+    //
+    template<typename T>
+    class ModelCompiler
+    {
+    private:
+        std::vector<int> _neuronsCountPerLayer;
+        std::vector<Math::Matrix<T>> _weights;
+        std::vector<Math::Matrix<T>> _bias;
+        std::vector<Activation> _activations;
+        int _unrollLimit;
+
+    public:
+        ModelCompiler(const Perceptron<T>& perceptron, Activation activation, int unrollLimit = 4096);
+        ModelCompiler(const Perceptron<T>& perceptron, const std::vector<Activation>& activationPerLayer, int unrollLimit = 4096);
+
+        void Emit(std::ostream& stream, const std::string& namespaceName) const;
+        void EmitToFile(const std::string& path, const std::string& namespaceName) const;
+
+        static Activation ParseActivation(const std::string& name);
+        static const char* GetActivationName(Activation activation);
+
+    private:
+        void EmitLayer(std::ostream& stream, int layerIndex, const std::string& input, const std::string& output) const;
+        static std::string FormatValue(T value);
+        static const char* GetTypeName();
+    };
+}
\ No newline at end of file
@@ -0,0 +1,360 @@
+#include "low_rank_perceptron.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+#include "math/random.h"
+
+namespace NeuralNetwork::Compression
+{
+    namespace
+    {
+        constexpr int InitialSketchRank = 16;
+        constexpr int JacobiSweepsLimit = 60;
+
+        double Dot(const double* lhv, const double* rhv, int count)
+        {
+            double sum = 0;
+            for (int i = 0; i < count; i++)
+            {
+                sum += lhv[i] * rhv[i];
+            }
+            return sum;
+        }
+
+        //
+        // Orthonormalizes rows of @matrix by modified Gram-Schmidt with reorthogonalization.
+        // Rows which are linear combinations of previous ones become zero.
+        //
+        void OrthonormalizeRows(Math::Matrix<double>& matrix)
+        {
+            int cols = matrix.GetCols();
+            for (int row = 0; row < matrix.GetRows(); row++)
+            {
+                double* current = &matrix(row, 0);
+                double initialNorm = std::sqrt(Dot(current, current, cols));
+                for (int pass = 0; pass < 2; pass++)
+                {
+                    for (int previous = 0; previous < row; previous++)
+                    {
+                        const double* basis = &matrix(previous, 0);
+                        double projection = Dot(current, basis, cols);
+                        for (int col = 0; col < cols; col++)
+                        {
+                            current[col] -= projection * basis[col];
+                        }
+                    }
+                }
+
+                double norm = std::sqrt(Dot(current, current, cols));
+                double scale = norm > 1e-12 * initialNorm && norm > 0.0 ? 1.0 / norm : 0.0;
+                for (int col = 0; col < cols; col++)
+                {
+                    current[col] *= scale;
+                }
+            }
+        }
+
+        //
+        // One-sided Jacobi SVD: rotates pairs of rows of @matrix until all rows are orthogonal, then their norms
+        //      are the singular values. The same rotations are applied to rows of @rotations.
+        // Starting with identity @rotations, original matrix = rotations^T * rotated matrix.
+        //
+        void OrthogonalizeRowsByJacobi(Math::Matrix<double>& matrix, Math::Matrix<double>& rotations)
+        {
+            int rows = matrix.GetRows();
+            int cols = matrix.GetCols();
+            for (int sweep = 0; sweep < JacobiSweepsLimit; sweep++)
+            {
+                bool isRotated = false;
+                for (int p = 0; p < rows - 1; p++)
+                {
+                    for (int q = p + 1; q < rows; q++)
+                    {
+                        double* rowP = &matrix(p, 0);
+                        double* rowQ = &matrix(q, 0);
+                        double alpha = Dot(rowP, rowP, cols);
+                        double beta = Dot(rowQ, rowQ, cols);
+                        double gamma = Dot(rowP, rowQ, cols);
+                        if (alpha == 0.0 || beta == 0.0 || std::fabs(gamma) <= 1e-15 * std::sqrt(alpha * beta))
+                            continue;
+
+                        double zeta = (beta - alpha) / (2.0 * gamma);
+                        double tangent = (zeta >= 0.0 ? 1.0 : -1.0) / (std::fabs(zeta) + std::sqrt(1.0 + zeta * zeta));
+                        double cosine = 1.0 / std::sqrt(1.0 + tangent * tangent);
+                        double sine = cosine * tangent;
+
+                        auto rotate = [cosine, sine](double* first, double* second, int count)
+                        {
+                            for (int i = 0; i < count; i++)
+                            {
+                                double x = first[i];
+                                double y = second[i];
+                                first[i] = cosine * x - sine * y;
+                                second[i] = sine * x + cosine * y;
+                            }
+                        };
+                        rotate(rowP, rowQ, cols);
+                        rotate(&rotations(p, 0), &rotations(q, 0), rotations.GetCols());
+                        isRotated = true;
+                    }
+                }
+
+                if (!isRotated)
+                    break;
+            }
+        }
+    }
+
+    //
+    // Factors every weight matrix of @perceptron, see LowRankOptions.
+    //
+    template<typename T>
+    LowRankPerceptron<T>::LowRankPerceptron(const Perceptron<T>& perceptron, const LowRankOptions& options) :
+        _neuronsCountPerLayer(perceptron.GetNeuronsCountPerLayer())
+    {
+        if (options.rank < 0)
+            throw std::invalid_argument("Rank must be non-negative");
+
+        if (options.tolerance < 0.0)
+            throw std::invalid_argument("Tolerance must be non-negative");
+
+        if (options.oversampling < 0 || options.powerIterations < 0)
+            throw std::invalid_argument("Oversampling and power iterations count must be non-negative");
+
+        int weightsCount = _neuronsCountPerLayer.size() - 1;
+        _layers.resize(weightsCount);
+        _values.resize(weightsCount);
+        _projections.resize(weightsCount);
+        for (int i = 0; i < weightsCount; i++)
+        {
+            const Math::Matrix<T>& weights = perceptron.GetWeights(i);
+            long long rows = weights.GetRows();
+            long long cols = weights.GetCols();
+            Layer& layer = _layers[i];
+            layer.bias = perceptron.GetBias(i);
+            layer.isFactored = false;
+            layer.rank = std::min(rows, cols);
+            layer.relativeError = 0.0;
+
+            if (options.rank == 0 || options.rank * (rows + cols) < rows * cols)
+            {
+                Math::Matrix<T> left;
+                Math::Matrix<T> right;
+                double relativeError = Factorize(weights, options, i, left, right);
+                int rank = left.GetCols();
+                if (rank * (rows + cols) < rows * cols)
+                {
+                    layer.isFactored = true;
+                    layer.rank = rank;
+                    layer.relativeError = relativeError;
+                    layer.left = std::move(left);
+                    layer.right = std::move(right);
+                    continue;
+                }
+            }
+            layer.weights = weights;
+        }
+    }
+
+    //
+    // Forward propagation for samples stored as columns of @inputValues.
+    //
+    template<typename T>
+    const Math::Matrix<T>& LowRankPerceptron<T>::ForwardPropagation(const Math::Matrix<T>& inputValues, T(*activationFunction)(T))
+    {
+        if (inputValues.GetRows() != _neuronsCountPerLayer[0])
+            throw std::invalid_argument("Rows count of input values not equal neurons count of input layer");
+
+        int samplesCount = inputValues.GetCols();
+        const Math::Matrix<T>* previous = &inputValues;
+        for (int i = 0; i < _layers.size(); i++)
+        {
+            Layer& layer = _layers[i];
+            Math::Matrix<T>& output = _values[i];
+            if (output.GetRows() != _neuronsCountPerLayer[i + 1] || output.GetCols() != samplesCount)
+                output = Math::Matrix<T>(_neuronsCountPerLayer[i + 1], samplesCount, false);
+
+            if (layer.isFactored)
+            {
+                Math::Matrix<T>& projection = _projections[i];
+                if (projection.GetRows() != layer.rank || projection.GetCols() != samplesCount)
+                    projection = Math::Matrix<T>(layer.rank, samplesCount, false);
+
+                projection.MultAndStoreThis(layer.right, *previous);
+                output.MultAndStoreThis(layer.left, projection);
+            }
+            else
+            {
+                output.MultAndStoreThis(layer.weights, *previous);
+            }
+
+            output
+                .AddToEachCol(layer.bias)
+                .ApplyFunction(activationFunction);
+            previous = &output;
+        }
+        return *previous;
+    }
+
+    template<typename T>
+    bool LowRankPerceptron<T>::IsFactored(int layerIndex) const
+    {
+        return _layers.at(layerIndex).isFactored;
+    }
+
+    //
+    // Returns rank of the factored layer, min(M, N) for a dense one.
+    //
+    template<typename T>
+    int LowRankPerceptron<T>::GetRank(int layerIndex) const
+    {
+        return _layers.at(layerIndex).rank;
+    }
+
+    //
+    // Returns ||W - U * V|| / ||W|| in Frobenius norm, 0 for a dense layer.
+    //
+    template<typename T>
+    double LowRankPerceptron<T>::GetRelativeError(int layerIndex) const
+    {
+        return _layers.at(layerIndex).relativeError;
+    }
+
+    //
+    // Returns the number of weights in factors and dense layers, bias excluded.
+    //
+    template<typename T>
+    std::size_t LowRankPerceptron<T>::GetWeightsCount() const
+    {
+        std::size_t count = 0;
+        for (int i = 0; i < _layers.size(); i++)
+        {
+            std::size_t rows = _neuronsCountPerLayer[i + 1];
+            std::size_t cols = _neuronsCountPerLayer[i];
+            count += _layers[i].isFactored ? _layers[i].rank * (rows + cols) : rows * cols;
+        }
+        return count;
+    }
+
+    //
+    // Factors @weights (M x N) into @left (M x r) and @right (r x N), returns the relative error in Frobenius norm.
+    // The error of the truncation is exact: Q Q^T projects W orthogonally, so ||W - U * V||^2 = ||W||^2 - sum of
+    //      squares of kept singular values. With a tolerance the sketch is doubled until the error is reached.
+    // Param @stream selects random numbers of the sketch, so layers get independent sketches for the same seed.
+    //
+    template<typename T>
+    double LowRankPerceptron<T>::Factorize(const Math::Matrix<T>& weights, const LowRankOptions& options, std::uint64_t stream,
+        Math::Matrix<T>& left, Math::Matrix<T>& right)
+    {
+        int rows = weights.GetRows();
+        int cols = weights.GetCols();
+        int maxRank = std::min(rows, cols);
+
+        Math::Matrix<double> matrix(rows, cols, false);
+        double normSquared = 0.0;
+        for (int row = 0; row < rows; row++)
+        {
+            for (int col = 0; col < cols; col++)
+            {
+                matrix(row, col) = weights(row, col);
+                normSquared += matrix(row, col) * matrix(row, col);
+            }
+        }
+
+        int sketchRank = options.rank > 0 ? std::min(options.rank, maxRank) : std::min(InitialSketchRank, maxRank);
+        while (true)
+        {
+            int sketchSize = std::min(sketchRank + options.oversampling, maxRank);
+
+            // Rows of range are the orthonormal basis Q^T of the dominant column space
+            Math::Matrix<double> sketch(sketchSize, cols, false);
+            Math::Random::FillNormal(sketch, 0, sketchSize, options.seed, stream, 0.0, 1.0);
+            Math::Matrix<double> range(sketchSize, rows, false);
+            Math::Matrix<double>::MultMatrixToTransposedAndStoreTo(sketch, matrix, range);
+            OrthonormalizeRows(range);
+
+            Math::Matrix<double> coRange(sketchSize, cols, false);
+            for (int iteration = 0; iteration < options.powerIterations; iteration++)
+            {
+                coRange.MultAndStoreThis(range, matrix);
+                OrthonormalizeRows(coRange);
+                Math::Matrix<double>::MultMatrixToTransposedAndStoreTo(coRange, matrix, range);
+                OrthonormalizeRows(range);
+            }
+
+            // Q^T * W = R^T * S, rows of S are orthogonal with norms equal to singular values
+            Math::Matrix<double> projected(sketchSize, cols, false);
+            projected.MultAndStoreThis(range, matrix);
+            Math::Matrix<double> rotations = Math::Matrix<double>::GetIdentity(sketchSize);
+            OrthogonalizeRowsByJacobi(projected, rotations);
+
+            std::vector<double> singularSquares(sketchSize);
+            for (int i = 0; i < sketchSize; i++)
+            {
+                singularSquares[i] = Dot(&projected(i, 0), &projected(i, 0), cols);
+            }
+            std::vector<int> order(sketchSize);
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&singularSquares](int lhv, int rhv) { return singularSquares[lhv] > singularSquares[rhv]; });
+
+            int rank = 0;
+            double keptSquares = 0.0;
+            if (options.rank > 0)
+            {
+                rank = std::min(options.rank, sketchSize);
+                for (int k = 0; k < rank; k++)
+                {
+                    keptSquares += singularSquares[order[k]];
+                }
+            }
+            else
+            {
+                double allowedSquares = options.tolerance * options.tolerance * normSquared;
+                while (rank < sketchSize && normSquared - keptSquares > allowedSquares)
+                {
+                    keptSquares += singularSquares[order[rank]];
+                    rank++;
+                }
+                if (normSquared - keptSquares > allowedSquares && sketchSize < maxRank)
+                {
+                    sketchRank *= 2;
+                    continue;
+                }
+            }
+            rank = std::max(rank, 1);
+
+            // U = Q * R^T restricted to kept rows of S, V = kept rows of S
+            Math::Matrix<double> keptRotations(rank, sketchSize, false);
+            right = Math::Matrix<T>(rank, cols, false);
+            for (int k = 0; k < rank; k++)
+            {
+                for (int i = 0; i < sketchSize; i++)
+                {
+                    keptRotations(k, i) = rotations(order[k], i);
+                }
+                for (int col = 0; col < cols; col++)
+                {
+                    right(k, col) = static_cast<T>(projected(order[k], col));
+                }
+            }
+            Math::Matrix<double> leftTransposed(rank, rows, false);
+            leftTransposed.MultAndStoreThis(keptRotations, range);
+            left = Math::Matrix<T>(rows, rank, false);
+            for (int row = 0; row < rows; row++)
+            {
+                for (int k = 0; k < rank; k++)
+                {
+                    left(row, k) = static_cast<T>(leftTransposed(k, row));
+                }
+            }
+
+            return normSquared > 0.0 ? std::sqrt(std::max(normSquared - keptSquares, 0.0) / normSquared) : 0.0;
+        }
+    }
+
+    template class LowRankPerceptron<float>;
+    template class LowRankPerceptron<double>;
+}
\ No newline at end of file
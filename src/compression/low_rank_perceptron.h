@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "perceptron.h"
+#include "math/matrix.h"
+
+namespace NeuralNetwork::Compression
+{
+    struct LowRankOptions
+    {
+        // Rank of every factored layer, 0 chooses the smallest rank within @tolerance
+        int rank = 0;
+        // Relative error in Frobenius norm, ||W - U * V|| <= tolerance * ||W||, used when @rank is 0
+        double tolerance = 1e-2;
+        // Extra columns of the random sketch and power iterations of the range finder, they improve accuracy
+        //      of the dominant subspace when singular values decay slowly
+        int oversampling = 8;
+        int powerIterations = 2;
+        std::uint64_t seed = 0;
+    };
+
+    //
+    // Perceptron with weight matrices factored into products of two thin matrices, W ~ U * V, where U is M x r and
+    //      V is r x N. A factored layer is computed as two matrix-vector products, V * a first, with r * (M + N)
+    //      multiplications and weights instead of M * N.
+    // Factorization is a truncated SVD computed by the randomized range finder: W is multiplied by a random
+    //      N x (r + p) matrix, the product is orthonormalized to Q, which spans the dominant column space of W,
+    //      and the small matrix Q^T * W is decomposed by one-sided Jacobi SVD. Computations are in double precision.
+    // Layers are kept dense when the chosen rank doesn't reduce the number of weights.
+    //
+    template<typename T>
+    class LowRankPerceptron
+    {
+    private:
+        struct Layer
+        {
+            bool isFactored;
+            int rank;
+            double relativeError;
+            // Dense weights, empty for a factored layer
+            Math::Matrix<T> weights;
+            // U and V of a factored layer, singular values are in V
+            Math::Matrix<T> left;
+            Math::Matrix<T> right;
+            Math::Matrix<T> bias;
+        };
+
+        std::vector<int> _neuronsCountPerLayer;
+        std::vector<Layer> _layers;
+
+        std::vector<Math::Matrix<T>> _values;
+        std::vector<Math::Matrix<T>> _projections;
+
+    public:
+        LowRankPerceptron(const Perceptron<T>& perceptron, const LowRankOptions& options);
+
+        const Math::Matrix<T>& ForwardPropagation(const Math::Matrix<T>& inputValues, T(*activationFunction)(T));
+
+        bool IsFactored(int layerIndex) const;
+        int GetRank(int layerIndex) const;
+        double GetRelativeError(int layerIndex) const;
+        std::size_t GetWeightsCount() const;
+
+        static double Factorize(const Math::Matrix<T>& weights, const LowRankOptions& options, std::uint64_t stream,
+            Math::Matrix<T>& left, Math::Matrix<T>& right);
+    };
+}
\ No newline at end of file
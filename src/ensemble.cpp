@@ -0,0 +1,149 @@
+#include "ensemble.h"
+
+#include <stdexcept>
+
+namespace NeuralNetwork
+{
+    template<typename T>
+    Ensemble<T>::Ensemble(const std::vector<Perceptron<T>>& members) : _membersCount(members.size())
+    {
+        if (members.empty())
+            throw std::invalid_argument("Ensemble must have at least one member");
+
+        _neuronsCountPerLayer = members[0].GetNeuronsCountPerLayer();
+
+        int layersCount = _neuronsCountPerLayer.size();
+        _weights.resize(layersCount - 1);
+        _bias.resize(layersCount - 1);
+        _layers.resize(layersCount);
+        for (int i = 0; i < layersCount - 1; i++)
+        {
+            _weights[i].resize(static_cast<std::size_t>(_membersCount) * _neuronsCountPerLayer[i + 1] * _neuronsCountPerLayer[i]);
+            _bias[i].resize(static_cast<std::size_t>(_membersCount) * _neuronsCountPerLayer[i + 1]);
+        }
+
+        for (int memberIndex = 0; memberIndex < _membersCount; memberIndex++)
+        {
+            SetMember(memberIndex, members[memberIndex]);
+        }
+    }
+
+    //
+    // Copies weights of @member to the stacked storage, @member must have the topology of the ensemble.
+    //
+    template<typename T>
+    void Ensemble<T>::SetMember(int memberIndex, const Perceptron<T>& member)
+    {
+        if (memberIndex < 0 || memberIndex >= _membersCount)
+            throw std::out_of_range("Member index out of range");
+
+        if (member.GetNeuronsCountPerLayer() != _neuronsCountPerLayer)
+            throw std::invalid_argument("Members of ensemble must have identical topology");
+
+        for (int i = 0; i < _weights.size(); i++)
+        {
+            const Math::Matrix<T>& weights = member.GetWeights(i);
+            const Math::Matrix<T>& bias = member.GetBias(i);
+            int rows = weights.GetRows();
+            int cols = weights.GetCols();
+
+            T* memberWeights = _weights[i].data() + static_cast<std::size_t>(memberIndex) * rows * cols;
+            T* memberBias = _bias[i].data() + static_cast<std::size_t>(memberIndex) * rows;
+            for (int row = 0; row < rows; row++)
+            {
+                for (int col = 0; col < cols; col++)
+                {
+                    memberWeights[row * cols + col] = weights(row, col);
+                }
+                memberBias[row] = bias(row, 0);
+            }
+        }
+    }
+
+    template<typename T>
+    int Ensemble<T>::GetMembersCount() const
+    {
+        return _membersCount;
+    }
+
+    //
+    // Evaluates all members on the batch of samples stored as columns of @inputValues.
+    // Returns the output averaged over members, outputs of each member are available with GetMembersOutput().
+    //
+    template<typename T>
+    const Math::Matrix<T>& Ensemble<T>::ForwardPropagation(const Math::Matrix<T>& inputValues, T(*activationFunction)(T))
+    {
+        if (inputValues.GetRows() != _neuronsCountPerLayer[0])
+            throw std::invalid_argument("Rows count of input values not equal neurons count of input layer");
+
+        int samplesCount = inputValues.GetCols();
+        std::vector<T>& input = _layers[0];
+        input.resize(static_cast<std::size_t>(_neuronsCountPerLayer[0]) * samplesCount);
+        for (int row = 0; row < inputValues.GetRows(); row++)
+        {
+            for (int sample = 0; sample < samplesCount; sample++)
+            {
+                input[row * samplesCount + sample] = inputValues(row, sample);
+            }
+        }
+
+        for (int i = 0; i < _weights.size(); i++)
+        {
+            int rows = _neuronsCountPerLayer[i + 1];
+            int inner = _neuronsCountPerLayer[i];
+            std::vector<T>& output = _layers[i + 1];
+            output.resize(static_cast<std::size_t>(_membersCount) * rows * samplesCount);
+
+            // The input layer is the same for all members
+            std::size_t inputStride = i == 0 ? 0 : static_cast<std::size_t>(inner) * samplesCount;
+            Math::Matrix<T>::MultStridedBatched(_membersCount, rows, samplesCount, inner,
+                _weights[i].data(), static_cast<std::size_t>(rows) * inner, _layers[i].data(), inputStride,
+                output.data(), static_cast<std::size_t>(rows) * samplesCount);
+
+            for (int row = 0; row < _membersCount * rows; row++)
+            {
+                T bias = _bias[i][row];
+                T* values = output.data() + static_cast<std::size_t>(row) * samplesCount;
+                for (int sample = 0; sample < samplesCount; sample++)
+                {
+                    values[sample] = activationFunction(values[sample] + bias);
+                }
+            }
+        }
+
+        int outputRows = _neuronsCountPerLayer.back();
+        const std::vector<T>& output = _layers.back();
+        if (_membersOutput.GetRows() != _membersCount * outputRows || _membersOutput.GetCols() != samplesCount)
+        {
+            _membersOutput = Math::Matrix<T>(_membersCount * outputRows, samplesCount, false);
+            _averageOutput = Math::Matrix<T>(outputRows, samplesCount, false);
+        }
+
+        _averageOutput.Fill(0);
+        for (int row = 0; row < _membersCount * outputRows; row++)
+        {
+            for (int sample = 0; sample < samplesCount; sample++)
+            {
+                T value = output[static_cast<std::size_t>(row) * samplesCount + sample];
+                _membersOutput(row, sample) = value;
+                _averageOutput(row % outputRows, sample) += value;
+            }
+        }
+        _averageOutput /= static_cast<T>(_membersCount);
+
+        return _averageOutput;
+    }
+
+    //
+    // Outputs of the members after the last ForwardPropagation(): rows [k * N, (k + 1) * N) belong to member k,
+    //      where N is neurons count of the output layer.
+    //
+    template<typename T>
+    const Math::Matrix<T>& Ensemble<T>::GetMembersOutput() const
+    {
+        return _membersOutput;
+    }
+
+    template class Ensemble<float>;
+    template class Ensemble<double>;
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+#include "perceptron.h"
+#include "math/matrix.h"
+
+namespace NeuralNetwork
+{
+    //
+    // Ensemble of perceptrons with identical topology evaluated in one fused pass.
+    // Weights of the members are stacked layer by layer, so every layer of all members is computed
+    //      by one strided-batched matrix multiplication (Matrix::MultStridedBatched()) instead of a separate
+    //      call per member. The first layer shares the input, so it is one product of the stacked weights.
+    //
+    template<typename T>
+    class Ensemble
+    {
+    private:
+        std::vector<int> _neuronsCountPerLayer;
+        int _membersCount;
+
+        // [layer][member * rows * cols + row * cols + col]
+        std::vector<std::vector<T>> _weights;
+        // [layer][member * rows + row]
+        std::vector<std::vector<T>> _bias;
+        // [layer][(member * rows + row) * samples + sample], the input layer is shared by members
+        std::vector<std::vector<T>> _layers;
+
+        Math::Matrix<T> _membersOutput;
+        Math::Matrix<T> _averageOutput;
+
+    public:
+        Ensemble(const std::vector<Perceptron<T>>& members);
+
+        void SetMember(int memberIndex, const Perceptron<T>& member);
+        int GetMembersCount() const;
+
+        const Math::Matrix<T>& ForwardPropagation(const Math::Matrix<T>& inputValues, T(*activationFunction)(T));
+        const Math::Matrix<T>& GetMembersOutput() const;
+    };
+}
\ No newline at end of file
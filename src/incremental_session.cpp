@@ -0,0 +1,183 @@
+#include "incremental_session.h"
+
+#include <stdexcept>
+
+namespace NeuralNetwork
+{
+    template<typename T>
+    IncrementalSession<T>::IncrementalSession(const Perceptron<T>& perceptron, T(*activationFunction)(T), int refreshInterval) :
+        _perceptron(perceptron),
+        _activationFunction(activationFunction),
+        _refreshInterval(refreshInterval),
+        _updatesSinceRefresh(0),
+        _hasInput(false)
+    {
+        std::vector<int> neuronsCountPerLayer = perceptron.GetNeuronsCountPerLayer();
+        if (neuronsCountPerLayer.size() < 2)
+            throw std::invalid_argument("Perceptron must have at least two layers");
+
+        if (refreshInterval < 1)
+            throw std::invalid_argument("Refresh interval must be positive");
+
+        _input = Math::Matrix<T>(neuronsCountPerLayer[0], 1);
+        _firstWeightedSums = Math::Matrix<T>(neuronsCountPerLayer[1], 1);
+        for (int i = 1; i < neuronsCountPerLayer.size(); i++)
+        {
+            _layers.push_back(Math::Matrix<T>(neuronsCountPerLayer[i], 1, false));
+        }
+
+        Reset();
+    }
+
+    //
+    // Copies the first layer weights again and drops the cached input, the next call of ForwardPropagation()
+    //      does a full recomputation.
+    //
+    template<typename T>
+    void IncrementalSession<T>::Reset()
+    {
+        _firstWeightsTransposed = _perceptron.GetWeights(0).Transpose();
+        _hasInput = false;
+        _updatesSinceRefresh = 0;
+    }
+
+    //
+    // Computes the output for @inputValues, only inputs which differ from the previous call are propagated
+    //      through the first layer.
+    //
+    template<typename T>
+    const Math::Matrix<T>& IncrementalSession<T>::ForwardPropagation(const Math::Matrix<T>& inputValues)
+    {
+        if (inputValues.GetRows() != _input.GetRows() || inputValues.GetCols() != 1)
+            throw std::invalid_argument("Input values must be a column with neurons count of input layer");
+
+        if (!_hasInput)
+        {
+            _input = inputValues;
+            Refresh();
+            return PropagateFromFirstLayer();
+        }
+
+        _changedInputs.clear();
+        for (int row = 0; row < _input.GetRows(); row++)
+        {
+            if (inputValues(row, 0) != _input(row, 0))
+                _changedInputs.push_back(row);
+        }
+
+        if (2 * _changedInputs.size() > _input.GetRows() || _updatesSinceRefresh >= _refreshInterval)
+        {
+            _input = inputValues;
+            Refresh();
+        }
+        else
+        {
+            ApplyChangedInputs(&inputValues(0, 0));
+        }
+        return PropagateFromFirstLayer();
+    }
+
+    //
+    // Sets inputs @indices of the cached input to @values and computes the output, no scan of the whole input is done.
+    // The session must have an input already, set by ForwardPropagation().
+    //
+    template<typename T>
+    const Math::Matrix<T>& IncrementalSession<T>::UpdateInputs(const std::vector<int>& indices, const std::vector<T>& values)
+    {
+        if (!_hasInput)
+            throw std::logic_error("Session has no input. Use ForwardPropagation() method.");
+
+        if (indices.size() != values.size())
+            throw std::invalid_argument("Indices count not equal values count");
+
+        for (int index : indices)
+        {
+            if (index < 0 || index >= _input.GetRows())
+                throw std::out_of_range("Input index out of range");
+        }
+
+        if (2 * indices.size() > _input.GetRows() || _updatesSinceRefresh >= _refreshInterval)
+        {
+            for (int i = 0; i < indices.size(); i++)
+            {
+                _input(indices[i], 0) = values[i];
+            }
+            Refresh();
+            return PropagateFromFirstLayer();
+        }
+
+        for (int i = 0; i < indices.size(); i++)
+        {
+            int index = indices[i];
+            T delta = values[i] - _input(index, 0);
+            if (delta == static_cast<T>(0.0))
+                continue;
+
+            const T* weights = &_firstWeightsTransposed(index, 0);
+            T* sums = &_firstWeightedSums(0, 0);
+            for (int row = 0; row < _firstWeightedSums.GetRows(); row++)
+            {
+                sums[row] += weights[row] * delta;
+            }
+            _input(index, 0) = values[i];
+        }
+        _updatesSinceRefresh++;
+        return PropagateFromFirstLayer();
+    }
+
+    template<typename T>
+    int IncrementalSession<T>::GetUpdatesSinceRefresh() const
+    {
+        return _updatesSinceRefresh;
+    }
+
+    template<typename T>
+    void IncrementalSession<T>::Refresh()
+    {
+        _firstWeightedSums
+            .MultAndStoreThis(_perceptron.GetWeights(0), _input)
+            .AddCol(_perceptron.GetBias(0), 0);
+        _updatesSinceRefresh = 0;
+        _hasInput = true;
+    }
+
+    //
+    // Rank-k update of the first layer weighted sums for inputs listed in _changedInputs.
+    //
+    template<typename T>
+    void IncrementalSession<T>::ApplyChangedInputs(const T* newValues)
+    {
+        T* sums = &_firstWeightedSums(0, 0);
+        int rows = _firstWeightedSums.GetRows();
+        for (int index : _changedInputs)
+        {
+            T delta = newValues[index] - _input(index, 0);
+            const T* weights = &_firstWeightsTransposed(index, 0);
+            for (int row = 0; row < rows; row++)
+            {
+                sums[row] += weights[row] * delta;
+            }
+            _input(index, 0) = newValues[index];
+        }
+        _updatesSinceRefresh++;
+    }
+
+    template<typename T>
+    const Math::Matrix<T>& IncrementalSession<T>::PropagateFromFirstLayer()
+    {
+        _layers[0] = _firstWeightedSums;
+        _layers[0].ApplyFunction(_activationFunction);
+
+        for (int i = 1; i < _layers.size(); i++)
+        {
+            _layers[i]
+                .MultAndStoreThis(_perceptron.GetWeights(i), _layers[i - 1])
+                .AddCol(_perceptron.GetBias(i), 0)
+                .ApplyFunction(_activationFunction);
+        }
+        return _layers.back();
+    }
+
+    template class IncrementalSession<float>;
+    template class IncrementalSession<double>;
+}
\ No newline at end of file
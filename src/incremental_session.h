@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+#include "perceptron.h"
+#include "math/matrix.h"
+
+namespace NeuralNetwork
+{
+    //
+    // Inference session for a stream of inputs which differ from the previous one in a few features.
+    // The session caches the input and the weighted sums of the first layer, z = W^0 * a^0 + b^0. When k inputs
+    //      change, z is updated by the rank-k correction z += W^0[:, j] * (new_j - old_j), which costs O(N * k)
+    //      instead of O(N * M); columns of W^0 are read from a transposed copy, so every correction is a contiguous row.
+    // Layers after the first one are recomputed as usual. A full recomputation is done when more than half of
+    //      the inputs change and after every @refreshInterval incremental updates, which bounds rounding drift.
+    // The session copies the first layer weights: call Reset() after the weights of the perceptron are changed.
+    //
+    template<typename T>
+    class IncrementalSession
+    {
+    private:
+        const Perceptron<T>& _perceptron;
+        T(*_activationFunction)(T);
+        int _refreshInterval;
+        int _updatesSinceRefresh;
+        bool _hasInput;
+
+        Math::Matrix<T> _firstWeightsTransposed;
+        Math::Matrix<T> _input;
+        Math::Matrix<T> _firstWeightedSums;
+        std::vector<Math::Matrix<T>> _layers;
+        std::vector<int> _changedInputs;
+
+    public:
+        IncrementalSession(const Perceptron<T>& perceptron, T(*activationFunction)(T), int refreshInterval = 1024);
+
+        void Reset();
+
+        const Math::Matrix<T>& ForwardPropagation(const Math::Matrix<T>& inputValues);
+        const Math::Matrix<T>& UpdateInputs(const std::vector<int>& indices, const std::vector<T>& values);
+
+        int GetUpdatesSinceRefresh() const;
+
+    private:
+        void Refresh();
+        void ApplyChangedInputs(const T* newValues);
+        const Math::Matrix<T>& PropagateFromFirstLayer();
+    };
+}
\ No newline at end of file
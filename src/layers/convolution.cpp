@@ -0,0 +1,461 @@
+#include "convolution.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "math/random.h"
+#include "threading/thread_pool.h"
+#include "profiling/tracer.h"
+
+namespace NeuralNetwork::Layers
+{
+    namespace
+    {
+        // Elements of _columns unfolded or folded by one task of the thread pool
+        constexpr int TaskSize = 1 << 14;
+
+        template<typename T>
+        void Reshape(Math::Matrix<T>& matrix, int rows, int cols)
+        {
+            if (matrix.GetRows() != rows || matrix.GetCols() != cols)
+                matrix = Math::Matrix<T>(rows, cols, false);
+        }
+    }
+
+    ConvolutionShape ConvolutionShape::Create1D(int inputChannels, int inputLength, int outputChannels, int kernelSize, int stride, int padding)
+    {
+        ConvolutionShape shape;
+        shape.inputChannels = inputChannels;
+        shape.inputWidth = inputLength;
+        shape.outputChannels = outputChannels;
+        shape.kernelWidth = kernelSize;
+        shape.strideWidth = stride;
+        shape.paddingWidth = padding;
+        return shape;
+    }
+
+    ConvolutionShape ConvolutionShape::Create2D(int inputChannels, int inputHeight, int inputWidth, int outputChannels, int kernelSize, int stride, int padding)
+    {
+        ConvolutionShape shape;
+        shape.inputChannels = inputChannels;
+        shape.inputHeight = inputHeight;
+        shape.inputWidth = inputWidth;
+        shape.outputChannels = outputChannels;
+        shape.kernelHeight = kernelSize;
+        shape.kernelWidth = kernelSize;
+        shape.strideHeight = stride;
+        shape.strideWidth = stride;
+        shape.paddingHeight = padding;
+        shape.paddingWidth = padding;
+        return shape;
+    }
+
+    int ConvolutionShape::GetOutputHeight() const
+    {
+        return (inputHeight + 2 * paddingHeight - kernelHeight) / strideHeight + 1;
+    }
+
+    int ConvolutionShape::GetOutputWidth() const
+    {
+        return (inputWidth + 2 * paddingWidth - kernelWidth) / strideWidth + 1;
+    }
+
+    template<typename T>
+    Convolution<T>::Convolution(const ConvolutionShape& shape) :
+        _shape(shape),
+        _outputHeight(0),
+        _outputWidth(0),
+        _cacheIsInitialized(false)
+    {
+        if (shape.inputChannels < 1 || shape.inputHeight < 1 || shape.inputWidth < 1 || shape.outputChannels < 1)
+            throw std::invalid_argument("Channels count and size of input must be positive");
+
+        if (shape.kernelHeight < 1 || shape.kernelWidth < 1 || shape.strideHeight < 1 || shape.strideWidth < 1)
+            throw std::invalid_argument("Kernel size and stride must be positive");
+
+        if (shape.paddingHeight < 0 || shape.paddingWidth < 0)
+            throw std::invalid_argument("Padding must be non-negative");
+
+        if (shape.inputHeight + 2 * shape.paddingHeight < shape.kernelHeight || shape.inputWidth + 2 * shape.paddingWidth < shape.kernelWidth)
+            throw std::invalid_argument("Kernel is larger than padded input");
+
+        _outputHeight = shape.GetOutputHeight();
+        _outputWidth = shape.GetOutputWidth();
+        _weights = Math::Matrix<T>(shape.outputChannels, shape.inputChannels * shape.kernelHeight * shape.kernelWidth);
+        _bias = Math::Matrix<T>(shape.outputChannels, 1);
+    }
+
+    //
+    // Same schemes as Perceptron::InitializeWeights(), fanIn is inputChannels * kernel area,
+    //      fanOut is outputChannels * kernel area. Bias is set to zero.
+    //
+    template<typename T>
+    void Convolution<T>::InitializeWeights(WeightsInitialization scheme, unsigned long long seed, T scale)
+    {
+        T kernelArea = static_cast<T>(_shape.kernelHeight * _shape.kernelWidth);
+        T fanIn = _shape.inputChannels * kernelArea;
+        T fanOut = _shape.outputChannels * kernelArea;
+        int rows = _weights.GetRows();
+
+        switch (scheme)
+        {
+        case WeightsInitialization::Uniform:
+            Math::Random::FillUniform(_weights, 0, rows, seed, 0, -scale, scale);
+            break;
+        case WeightsInitialization::Normal:
+            Math::Random::FillNormal(_weights, 0, rows, seed, 0, static_cast<T>(0.0), scale);
+            break;
+        case WeightsInitialization::XavierUniform:
+        {
+            T limit = scale * std::sqrt(static_cast<T>(6.0) / (fanIn + fanOut));
+            Math::Random::FillUniform(_weights, 0, rows, seed, 0, -limit, limit);
+            break;
+        }
+        case WeightsInitialization::XavierNormal:
+            Math::Random::FillNormal(_weights, 0, rows, seed, 0, static_cast<T>(0.0), scale * std::sqrt(static_cast<T>(2.0) / (fanIn + fanOut)));
+            break;
+        case WeightsInitialization::HeUniform:
+        {
+            T limit = scale * std::sqrt(static_cast<T>(6.0) / fanIn);
+            Math::Random::FillUniform(_weights, 0, rows, seed, 0, -limit, limit);
+            break;
+        }
+        case WeightsInitialization::HeNormal:
+            Math::Random::FillNormal(_weights, 0, rows, seed, 0, static_cast<T>(0.0), scale * std::sqrt(static_cast<T>(2.0) / fanIn));
+            break;
+        default:
+            throw std::invalid_argument("Unknown weights initialization scheme");
+        }
+        _bias.Fill(0);
+    }
+
+    //
+    // Propagates samples stored as columns of @inputValues, returns outputs of the samples as columns.
+    //
+    template<typename T>
+    const Math::Matrix<T>& Convolution<T>::ForwardPropagation(const Math::Matrix<T>& inputValues, T(*activationFunction)(T))
+    {
+        ComputeWeightedSums(inputValues);
+
+        _NN_TRACE_SCOPE("forward", "Activation", -1);
+        return _outputValues.ApplyFunction(activationFunction);
+    }
+
+    //
+    // Forward propagation which keeps unfolded input and derivatives for BackwardPropagation().
+    // Param @cacheAfterActivationFunction has the same meaning as in Perceptron::ForwardPropagationWithCache().
+    //
+    template<typename T>
+    const Math::Matrix<T>& Convolution<T>::ForwardPropagationWithCache(const Math::Matrix<T>& inputValues, T(*activationFunction)(T), T(*derivativeFunction)(T), bool cacheAfterActivationFunction)
+    {
+        if (!_cacheIsInitialized)
+            throw std::logic_error("Cache is not initialized. Use InitTrainCache() method.");
+
+        ComputeWeightedSums(inputValues);
+
+        if (cacheAfterActivationFunction)
+        {
+            _outputValues.ApplyFunction(activationFunction);
+            _derivatives = _outputValues;
+            _derivatives.ApplyFunction(derivativeFunction);
+        }
+        else
+        {
+            _derivatives = _outputValues;
+            _derivatives.ApplyFunction(derivativeFunction);
+            _outputValues.ApplyFunction(activationFunction);
+        }
+        return _outputValues;
+    }
+
+    //
+    // Param @outputGradient is the gradient of the loss with respect to the outputs of the last ForwardPropagationWithCache(),
+    //      one column per sample. Gradients of weights and bias are averaged over the samples.
+    // Returns the gradient with respect to the inputs, to be passed to the previous layer. It is computed
+    //      with weights before the adjustment, @computeInputGradient = false skips it for the first layer.
+    //
+    template<typename T>
+    const Math::Matrix<T>& Convolution<T>::BackwardPropagation(const Math::Matrix<T>& outputGradient, T learningRate, T moment, bool computeInputGradient)
+    {
+        if (!_cacheIsInitialized)
+            throw std::logic_error("Cache is not initialized. Use InitTrainCache() method.");
+
+        if (outputGradient.GetRows() != _derivatives.GetRows() || outputGradient.GetCols() != _derivatives.GetCols())
+            throw std::invalid_argument("Size of output gradient not equal size of output of the last forward propagation");
+
+        int samplesCount = outputGradient.GetCols();
+        int outputPixels = _outputHeight * _outputWidth;
+        {
+            _NN_TRACE_SCOPE("backward", "Delta", -1);
+            Reshape(_deltas, _shape.outputChannels, samplesCount * outputPixels);
+            for (int channel = 0; channel < _shape.outputChannels; channel++)
+            {
+                T* deltas = &_deltas(channel, 0);
+                for (int pixel = 0; pixel < outputPixels; pixel++)
+                {
+                    int row = channel * outputPixels + pixel;
+                    for (int sample = 0; sample < samplesCount; sample++)
+                    {
+                        deltas[sample * outputPixels + pixel] = outputGradient(row, sample) * _derivatives(row, sample);
+                    }
+                }
+            }
+        }
+
+        {
+            _NN_TRACE_SCOPE("backward", "WeightsGradient", -1);
+            T scale = static_cast<T>(1.0) / samplesCount;
+            Math::Matrix<T>::MultMatrixToTransposedAndStoreTo(_deltas, _columns, _deltasWeights);
+            _deltasWeights *= scale;
+            _deltasBias.SumColsAndStoreThis(_deltas);
+            _deltasBias *= scale;
+        }
+
+        if (computeInputGradient)
+        {
+            _NN_TRACE_SCOPE("backward", "InputGradient", -1);
+            Reshape(_columnsGradient, _columns.GetRows(), _columns.GetCols());
+            Math::Matrix<T>::MultTransposedToMatrixAndStoreTo(_weights, _deltas, _columnsGradient);
+            FoldColumnsGradient(samplesCount);
+        }
+
+        AdjustWeights(learningRate, moment);
+        return _inputGradient;
+    }
+
+    template<typename T>
+    void Convolution<T>::InitTrainCache()
+    {
+        _cacheIsInitialized = true;
+        _deltasWeights = Math::Matrix<T>(_weights.GetRows(), _weights.GetCols(), false);
+        _deltasBias = Math::Matrix<T>(_bias.GetRows(), 1, false);
+        _deltasWeightsInertia = Math::Matrix<T>(_weights.GetRows(), _weights.GetCols());
+        _deltasBiasInertia = Math::Matrix<T>(_bias.GetRows(), 1);
+    }
+
+    template<typename T>
+    void Convolution<T>::ClearTrainCache()
+    {
+        _cacheIsInitialized = false;
+        _derivatives = Math::Matrix<T>();
+        _deltas = Math::Matrix<T>();
+        _deltasWeights = Math::Matrix<T>();
+        _deltasBias = Math::Matrix<T>();
+        _deltasWeightsInertia = Math::Matrix<T>();
+        _deltasBiasInertia = Math::Matrix<T>();
+        _columnsGradient = Math::Matrix<T>();
+        _inputGradient = Math::Matrix<T>();
+    }
+
+    template<typename T>
+    const ConvolutionShape& Convolution<T>::GetShape() const
+    {
+        return _shape;
+    }
+
+    //
+    // Returns rows count of input values: inputChannels * inputHeight * inputWidth.
+    //
+    template<typename T>
+    int Convolution<T>::GetInputSize() const
+    {
+        return _shape.inputChannels * _shape.inputHeight * _shape.inputWidth;
+    }
+
+    //
+    // Returns rows count of output values: outputChannels * outputHeight * outputWidth.
+    //
+    template<typename T>
+    int Convolution<T>::GetOutputSize() const
+    {
+        return _shape.outputChannels * _outputHeight * _outputWidth;
+    }
+
+    template<typename T>
+    std::size_t Convolution<T>::GetParametersCount() const
+    {
+        return static_cast<std::size_t>(_weights.GetRows()) * _weights.GetCols() + _bias.GetRows();
+    }
+
+    //
+    // Returns weights as outputChannels x (inputChannels * kernelHeight * kernelWidth) matrix,
+    //      kernel of output channel (o) and input channel (c) is row (o) from column (c * kh * kw), row by row.
+    //
+    template<typename T>
+    const Math::Matrix<T>& Convolution<T>::GetWeights() const
+    {
+        return _weights;
+    }
+
+    template<typename T>
+    const Math::Matrix<T>& Convolution<T>::GetBias() const
+    {
+        return _bias;
+    }
+
+    template<typename T>
+    void Convolution<T>::SetParameters(const Math::Matrix<T>& weights, const Math::Matrix<T>& bias)
+    {
+        if (weights.GetRows() != _weights.GetRows() || weights.GetCols() != _weights.GetCols())
+            throw std::invalid_argument("Size of weights not equal size of convolution weights");
+
+        if (bias.GetRows() != _bias.GetRows() || bias.GetCols() != 1)
+            throw std::invalid_argument("Size of bias not equal outputs channels count");
+
+        _weights = weights;
+        _bias = bias;
+    }
+
+    template<typename T>
+    void Convolution<T>::ComputeWeightedSums(const Math::Matrix<T>& inputValues)
+    {
+        if (inputValues.GetRows() != GetInputSize())
+            throw std::invalid_argument("Rows count of input values not equal input size of convolution");
+
+        if (inputValues.GetCols() < 1)
+            throw std::invalid_argument("Input values must contain at least one sample");
+
+        int samplesCount = inputValues.GetCols();
+        int outputPixels = _outputHeight * _outputWidth;
+        UnfoldInput(inputValues);
+        {
+            _NN_TRACE_SCOPE("forward", "GEMM", -1);
+            Reshape(_products, _shape.outputChannels, samplesCount * outputPixels);
+            _products.MultAndStoreThis(_weights, _columns);
+        }
+
+        Reshape(_outputValues, GetOutputSize(), samplesCount);
+        for (int channel = 0; channel < _shape.outputChannels; channel++)
+        {
+            const T* products = &_products(channel, 0);
+            T bias = _bias(channel, 0);
+            for (int pixel = 0; pixel < outputPixels; pixel++)
+            {
+                T* output = &_outputValues(channel * outputPixels + pixel, 0);
+                for (int sample = 0; sample < samplesCount; sample++)
+                {
+                    output[sample] = products[sample * outputPixels + pixel] + bias;
+                }
+            }
+        }
+    }
+
+    //
+    // im2col: fills _columns from @inputValues, positions of the kernel outside of the input are zeros.
+    //
+    template<typename T>
+    void Convolution<T>::UnfoldInput(const Math::Matrix<T>& inputValues)
+    {
+        _NN_TRACE_SCOPE("forward", "Im2Col", -1);
+        int samplesCount = inputValues.GetCols();
+        int kernelArea = _shape.kernelHeight * _shape.kernelWidth;
+        int outputPixels = _outputHeight * _outputWidth;
+        Reshape(_columns, _shape.inputChannels * kernelArea, samplesCount * outputPixels);
+
+        const T* input = &inputValues(0, 0);
+        int rowsPerTask = std::max(1, TaskSize / _columns.GetCols());
+        Threading::ThreadPool::GetDefault().ParallelFor(0, _columns.GetRows(), rowsPerTask, [this, input, samplesCount, kernelArea, outputPixels](int begin, int end)
+            {
+                for (int row = begin; row < end; row++)
+                {
+                    int channel = row / kernelArea;
+                    int kernelY = row % kernelArea / _shape.kernelWidth;
+                    int kernelX = row % _shape.kernelWidth;
+                    T* columns = &_columns(row, 0);
+                    for (int sample = 0; sample < samplesCount; sample++)
+                    {
+                        for (int outputY = 0; outputY < _outputHeight; outputY++)
+                        {
+                            T* output = columns + sample * outputPixels + outputY * _outputWidth;
+                            int inputY = outputY * _shape.strideHeight - _shape.paddingHeight + kernelY;
+                            if (inputY < 0 || inputY >= _shape.inputHeight)
+                            {
+                                std::fill(output, output + _outputWidth, static_cast<T>(0));
+                                continue;
+                            }
+
+                            // Element (c, y, x) of a sample is in row (c * H + y) * W + x, samples are interleaved
+                            const T* inputRow = input + (static_cast<std::size_t>(channel * _shape.inputHeight + inputY) * _shape.inputWidth) * samplesCount + sample;
+                            for (int outputX = 0; outputX < _outputWidth; outputX++)
+                            {
+                                int inputX = outputX * _shape.strideWidth - _shape.paddingWidth + kernelX;
+                                output[outputX] = inputX >= 0 && inputX < _shape.inputWidth ? inputRow[static_cast<std::size_t>(inputX) * samplesCount] : static_cast<T>(0);
+                            }
+                        }
+                    }
+                }
+            });
+    }
+
+    //
+    // col2im: sums gradients of _columns into _inputGradient. Rows of one input channel are folded by one task,
+    //      so tasks write disjoint parts of the gradient.
+    //
+    template<typename T>
+    void Convolution<T>::FoldColumnsGradient(int samplesCount)
+    {
+        _NN_TRACE_SCOPE("backward", "Col2Im", -1);
+        int kernelArea = _shape.kernelHeight * _shape.kernelWidth;
+        int outputPixels = _outputHeight * _outputWidth;
+        Reshape(_inputGradient, GetInputSize(), samplesCount);
+        _inputGradient.Fill(0);
+
+        T* gradient = &_inputGradient(0, 0);
+        int channelsPerTask = std::max(1, TaskSize / (kernelArea * _columnsGradient.GetCols()));
+        Threading::ThreadPool::GetDefault().ParallelFor(0, _shape.inputChannels, channelsPerTask, [this, gradient, samplesCount, kernelArea, outputPixels](int begin, int end)
+            {
+                for (int channel = begin; channel < end; channel++)
+                {
+                    for (int kernelIndex = 0; kernelIndex < kernelArea; kernelIndex++)
+                    {
+                        int kernelY = kernelIndex / _shape.kernelWidth;
+                        int kernelX = kernelIndex % _shape.kernelWidth;
+                        const T* columns = &_columnsGradient(channel * kernelArea + kernelIndex, 0);
+                        for (int sample = 0; sample < samplesCount; sample++)
+                        {
+                            for (int outputY = 0; outputY < _outputHeight; outputY++)
+                            {
+                                int inputY = outputY * _shape.strideHeight - _shape.paddingHeight + kernelY;
+                                if (inputY < 0 || inputY >= _shape.inputHeight)
+                                    continue;
+
+                                const T* source = columns + sample * outputPixels + outputY * _outputWidth;
+                                T* gradientRow = gradient + (static_cast<std::size_t>(channel * _shape.inputHeight + inputY) * _shape.inputWidth) * samplesCount + sample;
+                                for (int outputX = 0; outputX < _outputWidth; outputX++)
+                                {
+                                    int inputX = outputX * _shape.strideWidth - _shape.paddingWidth + kernelX;
+                                    if (inputX >= 0 && inputX < _shape.inputWidth)
+                                        gradientRow[static_cast<std::size_t>(inputX) * samplesCount] += source[outputX];
+                                }
+                            }
+                        }
+                    }
+                }
+            });
+    }
+
+    //
+    // The same momentum update as Perceptron::AdjustWeights().
+    //
+    template<typename T>
+    void Convolution<T>::AdjustWeights(T learningRate, T moment)
+    {
+        _NN_TRACE_SCOPE("backward", "AdjustWeights", -1);
+        _deltasWeightsInertia *= moment;
+        _deltasBiasInertia *= moment;
+        _deltasWeights *= (static_cast<T>(1.0) - moment);
+        _deltasBias *= (static_cast<T>(1.0) - moment);
+        _deltasWeightsInertia += _deltasWeights;
+        _deltasBiasInertia += _deltasBias;
+
+        _deltasWeights.MultAndStoreThis(_deltasWeightsInertia, learningRate);
+        _deltasBias.MultAndStoreThis(_deltasBiasInertia, learningRate);
+
+        _weights -= _deltasWeights;
+        _bias -= _deltasBias;
+    }
+
+    template class Convolution<float>;
+    template class Convolution<double>;
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "perceptron.h"
+#include "math/matrix.h"
+
+namespace NeuralNetwork::Layers
+{
+    //
+    // Geometry of a convolution. One-dimensional convolutions have height of input and kernel equal to 1.
+    //
+    struct ConvolutionShape
+    {
+        int inputChannels = 1;
+        int inputHeight = 1;
+        int inputWidth = 1;
+        int outputChannels = 1;
+        int kernelHeight = 1;
+        int kernelWidth = 1;
+        int strideHeight = 1;
+        int strideWidth = 1;
+        // Zeros added on both sides of the input
+        int paddingHeight = 0;
+        int paddingWidth = 0;
+
+        static ConvolutionShape Create1D(int inputChannels, int inputLength, int outputChannels, int kernelSize, int stride = 1, int padding = 0);
+        static ConvolutionShape Create2D(int inputChannels, int inputHeight, int inputWidth, int outputChannels, int kernelSize, int stride = 1, int padding = 0);
+
+        int GetOutputHeight() const;
+        int GetOutputWidth() const;
+    };
+
+    //
+    // Convolutional layer lowered to matrix multiplication. Samples are columns of the input and output matrices,
+    //      every column is a channels x height x width tensor flattened channel by channel, so the output can be
+    //      passed to another convolution or to a perceptron.
+    // Forward propagation unfolds input patches into columns (im2col): row (c, ky, kx) and column (sample, y, x)
+    //      of _columns hold the input value under kernel position (ky, kx) of channel (c) for output pixel (y, x).
+    //      Then all output channels of the batch are one product of weights (outputChannels x c * kh * kw)
+    //      and _columns. Backward propagation is two products with the same matrices and folding of the
+    //      gradient of columns back to the input (col2im).
+    //
+    template<typename T>
+    class Convolution
+    {
+    private:
+        ConvolutionShape _shape;
+        int _outputHeight;
+        int _outputWidth;
+
+        Math::Matrix<T> _weights;
+        Math::Matrix<T> _bias;
+
+        // [c * kh * kw + ky * kw + kx][sample * outputPixels + y * outputWidth + x]
+        Math::Matrix<T> _columns;
+        // [outputChannel][sample * outputPixels + pixel]
+        Math::Matrix<T> _products;
+        Math::Matrix<T> _outputValues;
+
+        bool _cacheIsInitialized;
+        Math::Matrix<T> _derivatives;
+        Math::Matrix<T> _deltas;
+        Math::Matrix<T> _deltasWeights;
+        Math::Matrix<T> _deltasBias;
+        Math::Matrix<T> _deltasWeightsInertia;
+        Math::Matrix<T> _deltasBiasInertia;
+        Math::Matrix<T> _columnsGradient;
+        Math::Matrix<T> _inputGradient;
+
+    public:
+        explicit Convolution(const ConvolutionShape& shape);
+
+        void InitializeWeights(WeightsInitialization scheme, unsigned long long seed, T scale = 1);
+
+        const Math::Matrix<T>& ForwardPropagation(const Math::Matrix<T>& inputValues, T(*activationFunction)(T));
+        const Math::Matrix<T>& ForwardPropagationWithCache(const Math::Matrix<T>& inputValues, T(*activationFunction)(T), T(*derivativeFunction)(T), bool cacheAfterActivationFunction = false);
+        const Math::Matrix<T>& BackwardPropagation(const Math::Matrix<T>& outputGradient, T learningRate, T moment, bool computeInputGradient = true);
+
+        void InitTrainCache();
+        void ClearTrainCache();
+
+        const ConvolutionShape& GetShape() const;
+        int GetInputSize() const;
+        int GetOutputSize() const;
+        std::size_t GetParametersCount() const;
+
+        const Math::Matrix<T>& GetWeights() const;
+        const Math::Matrix<T>& GetBias() const;
+        void SetParameters(const Math::Matrix<T>& weights, const Math::Matrix<T>& bias);
+
+    private:
+        void ComputeWeightedSums(const Math::Matrix<T>& inputValues);
+        void UnfoldInput(const Math::Matrix<T>& inputValues);
+        void FoldColumnsGradient(int samplesCount);
+        void AdjustWeights(T learningRate, T moment);
+    };
+}
\ No newline at end of file
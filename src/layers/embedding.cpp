@@ -0,0 +1,255 @@
+#include "embedding.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "math/random.h"
+#include "profiling/tracer.h"
+
+namespace NeuralNetwork::Layers
+{
+    template<typename T>
+    Embedding<T>::Embedding(const std::vector<int>& vocabularySizes, int dimension) :
+        _vocabularySizes(vocabularySizes),
+        _dimension(dimension),
+        _cacheIsInitialized(false)
+    {
+        if (vocabularySizes.empty())
+            throw std::invalid_argument("Fields count must be positive");
+
+        if (dimension < 1)
+            throw std::invalid_argument("Dimension of embedding must be positive");
+
+        int rowsCount = 0;
+        for (int vocabularySize : vocabularySizes)
+        {
+            if (vocabularySize < 1)
+                throw std::invalid_argument("Vocabulary size must be positive");
+
+            _fieldOffsets.push_back(rowsCount);
+            rowsCount += vocabularySize;
+        }
+        _table = Math::Matrix<T>(rowsCount, dimension);
+    }
+
+    //
+    // Same schemes as Perceptron::InitializeWeights() for the equivalent layer on one-hot inputs of each field:
+    //      fanIn is the vocabulary size of the field, fanOut is the dimension. Every field has its own random stream.
+    //
+    template<typename T>
+    void Embedding<T>::InitializeWeights(WeightsInitialization scheme, unsigned long long seed, T scale)
+    {
+        for (int field = 0; field < _vocabularySizes.size(); field++)
+        {
+            T fanIn = static_cast<T>(_vocabularySizes[field]);
+            T fanOut = static_cast<T>(_dimension);
+            int rowBegin = _fieldOffsets[field];
+            int rowEnd = rowBegin + _vocabularySizes[field];
+
+            switch (scheme)
+            {
+            case WeightsInitialization::Uniform:
+                Math::Random::FillUniform(_table, rowBegin, rowEnd, seed, field, -scale, scale);
+                break;
+            case WeightsInitialization::Normal:
+                Math::Random::FillNormal(_table, rowBegin, rowEnd, seed, field, static_cast<T>(0.0), scale);
+                break;
+            case WeightsInitialization::XavierUniform:
+            {
+                T limit = scale * std::sqrt(static_cast<T>(6.0) / (fanIn + fanOut));
+                Math::Random::FillUniform(_table, rowBegin, rowEnd, seed, field, -limit, limit);
+                break;
+            }
+            case WeightsInitialization::XavierNormal:
+                Math::Random::FillNormal(_table, rowBegin, rowEnd, seed, field, static_cast<T>(0.0), scale * std::sqrt(static_cast<T>(2.0) / (fanIn + fanOut)));
+                break;
+            case WeightsInitialization::HeUniform:
+            {
+                T limit = scale * std::sqrt(static_cast<T>(6.0) / fanIn);
+                Math::Random::FillUniform(_table, rowBegin, rowEnd, seed, field, -limit, limit);
+                break;
+            }
+            case WeightsInitialization::HeNormal:
+                Math::Random::FillNormal(_table, rowBegin, rowEnd, seed, field, static_cast<T>(0.0), scale * std::sqrt(static_cast<T>(2.0) / fanIn));
+                break;
+            default:
+                throw std::invalid_argument("Unknown weights initialization scheme");
+            }
+        }
+    }
+
+    //
+    // Param @categories holds fieldsCount categories per sample, sample by sample.
+    // Returns vectors of the samples as columns, vector of field (f) is in rows [f * dimension, (f + 1) * dimension).
+    //
+    template<typename T>
+    const Math::Matrix<T>& Embedding<T>::ForwardPropagation(const std::vector<int>& categories)
+    {
+        _NN_TRACE_SCOPE("forward", "Gather", -1);
+        int fieldsCount = _vocabularySizes.size();
+        if (categories.empty() || categories.size() % fieldsCount != 0)
+            throw std::invalid_argument("Categories count must be a positive multiple of fields count");
+
+        int samplesCount = categories.size() / fieldsCount;
+        _rows.resize(categories.size());
+        for (int i = 0; i < categories.size(); i++)
+        {
+            _rows[i] = GetTableRow(i % fieldsCount, categories[i]);
+        }
+
+        if (_outputValues.GetRows() != GetOutputSize() || _outputValues.GetCols() != samplesCount)
+            _outputValues = Math::Matrix<T>(GetOutputSize(), samplesCount, false);
+
+        for (int sample = 0; sample < samplesCount; sample++)
+        {
+            for (int field = 0; field < fieldsCount; field++)
+            {
+                const T* vector = &_table(_rows[sample * fieldsCount + field], 0);
+                for (int component = 0; component < _dimension; component++)
+                {
+                    _outputValues(field * _dimension + component, sample) = vector[component];
+                }
+            }
+        }
+        return _outputValues;
+    }
+
+    //
+    // Param @outputGradient is the gradient of the loss with respect to the output of the last ForwardPropagation(),
+    //      for example Perceptron::GetInputGradient() of the perceptron fed by the embedding.
+    // Gradients of rows are summed over their uses and averaged over samples, then only the used rows and
+    //      their inertia are adjusted by the momentum update of Perceptron::AdjustWeights().
+    //
+    template<typename T>
+    void Embedding<T>::BackwardPropagation(const Math::Matrix<T>& outputGradient, T learningRate, T moment)
+    {
+        if (!_cacheIsInitialized)
+            throw std::logic_error("Cache is not initialized. Use InitTrainCache() method.");
+
+        if (outputGradient.GetRows() != _outputValues.GetRows() || outputGradient.GetCols() != _outputValues.GetCols())
+            throw std::invalid_argument("Size of output gradient not equal size of output of the last forward propagation");
+
+        int fieldsCount = _vocabularySizes.size();
+        int samplesCount = outputGradient.GetCols();
+        {
+            _NN_TRACE_SCOPE("backward", "WeightsGradient", -1);
+            _touchedRows.clear();
+            _rowsGradient.clear();
+            for (int sample = 0; sample < samplesCount; sample++)
+            {
+                for (int field = 0; field < fieldsCount; field++)
+                {
+                    int row = _rows[sample * fieldsCount + field];
+                    int& position = _touchedRowPositions[row];
+                    if (position < 0)
+                    {
+                        position = _touchedRows.size();
+                        _touchedRows.push_back(row);
+                        _rowsGradient.resize(_rowsGradient.size() + _dimension, static_cast<T>(0));
+                    }
+
+                    T* gradient = _rowsGradient.data() + static_cast<std::size_t>(position) * _dimension;
+                    for (int component = 0; component < _dimension; component++)
+                    {
+                        gradient[component] += outputGradient(field * _dimension + component, sample);
+                    }
+                }
+            }
+        }
+
+        _NN_TRACE_SCOPE("backward", "AdjustWeights", -1);
+        T gradientScale = (static_cast<T>(1.0) - moment) / samplesCount;
+        for (int position = 0; position < _touchedRows.size(); position++)
+        {
+            int row = _touchedRows[position];
+            const T* gradient = _rowsGradient.data() + static_cast<std::size_t>(position) * _dimension;
+            T* inertia = &_tableInertia(row, 0);
+            T* weights = &_table(row, 0);
+            for (int component = 0; component < _dimension; component++)
+            {
+                inertia[component] = inertia[component] * moment + gradient[component] * gradientScale;
+                weights[component] -= inertia[component] * learningRate;
+            }
+            _touchedRowPositions[row] = -1;
+        }
+    }
+
+    template<typename T>
+    void Embedding<T>::InitTrainCache()
+    {
+        _cacheIsInitialized = true;
+        _tableInertia = Math::Matrix<T>(_table.GetRows(), _dimension);
+        _touchedRowPositions.assign(_table.GetRows(), -1);
+    }
+
+    template<typename T>
+    void Embedding<T>::ClearTrainCache()
+    {
+        _cacheIsInitialized = false;
+        _tableInertia = Math::Matrix<T>();
+        std::vector<int>().swap(_touchedRowPositions);
+        std::vector<int>().swap(_touchedRows);
+        std::vector<T>().swap(_rowsGradient);
+    }
+
+    template<typename T>
+    int Embedding<T>::GetFieldsCount() const
+    {
+        return _vocabularySizes.size();
+    }
+
+    template<typename T>
+    int Embedding<T>::GetVocabularySize(int fieldIndex) const
+    {
+        return _vocabularySizes.at(fieldIndex);
+    }
+
+    template<typename T>
+    int Embedding<T>::GetDimension() const
+    {
+        return _dimension;
+    }
+
+    //
+    // Returns rows count of output values: fieldsCount * dimension.
+    //
+    template<typename T>
+    int Embedding<T>::GetOutputSize() const
+    {
+        return _vocabularySizes.size() * _dimension;
+    }
+
+    //
+    // Returns row of _table with the vector of @category of field @fieldIndex.
+    //
+    template<typename T>
+    int Embedding<T>::GetTableRow(int fieldIndex, int category) const
+    {
+        if (category < 0 || category >= _vocabularySizes.at(fieldIndex))
+            throw std::out_of_range("Category is out of vocabulary of the field");
+
+        return _fieldOffsets[fieldIndex] + category;
+    }
+
+    //
+    // Returns vectors of all fields, rows of field (f) start at GetTableRow(f, 0).
+    //
+    template<typename T>
+    const Math::Matrix<T>& Embedding<T>::GetTable() const
+    {
+        return _table;
+    }
+
+    template<typename T>
+    void Embedding<T>::SetTable(const Math::Matrix<T>& table)
+    {
+        if (table.GetRows() != _table.GetRows() || table.GetCols() != _table.GetCols())
+            throw std::invalid_argument("Size of table not equal size of embedding table");
+
+        _table = table;
+    }
+
+    template class Embedding<float>;
+    template class Embedding<double>;
+}
\ No newline at end of file
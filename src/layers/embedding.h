@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+#include "perceptron.h"
+#include "math/matrix.h"
+
+namespace NeuralNetwork::Layers
+{
+    //
+    // Embedding of categorical features: every feature (field) has its own table of vectors, a sample is
+    //      a list of category indices, one per field, and its output is the concatenation of their vectors.
+    // It equals a fully connected layer without bias on one-hot inputs, but forward propagation gathers
+    //      fieldsCount rows instead of multiplying the whole matrix, and backward propagation updates only
+    //      the rows used by the batch, with their momentum inertia. Cost of both is proportional to the
+    //      number of active features, not to the vocabulary size.
+    // Momentum is lazy: inertia of a row decays only on the steps which use the row.
+    //
+    template<typename T>
+    class Embedding
+    {
+    private:
+        std::vector<int> _vocabularySizes;
+        // First row of every field in _table
+        std::vector<int> _fieldOffsets;
+        int _dimension;
+
+        // [fieldOffset + category][component]
+        Math::Matrix<T> _table;
+        Math::Matrix<T> _outputValues;
+        // Rows of _table used by the last forward propagation, [sample * fieldsCount + field]
+        std::vector<int> _rows;
+
+        bool _cacheIsInitialized;
+        Math::Matrix<T> _tableInertia;
+        // Rows touched by the batch in order of first use, and position of every table row in it (-1 for untouched)
+        std::vector<int> _touchedRows;
+        std::vector<int> _touchedRowPositions;
+        // [position in _touchedRows][component]
+        std::vector<T> _rowsGradient;
+
+    public:
+        Embedding(const std::vector<int>& vocabularySizes, int dimension);
+
+        void InitializeWeights(WeightsInitialization scheme, unsigned long long seed, T scale = 1);
+
+        const Math::Matrix<T>& ForwardPropagation(const std::vector<int>& categories);
+        void BackwardPropagation(const Math::Matrix<T>& outputGradient, T learningRate, T moment);
+
+        void InitTrainCache();
+        void ClearTrainCache();
+
+        int GetFieldsCount() const;
+        int GetVocabularySize(int fieldIndex) const;
+        int GetDimension() const;
+        int GetOutputSize() const;
+        int GetTableRow(int fieldIndex, int category) const;
+
+        const Math::Matrix<T>& GetTable() const;
+        void SetTable(const Math::Matrix<T>& table);
+    };
+}
\ No newline at end of file
@@ -2,6 +2,19 @@
 
 namespace NeuralNetwork::Math::Functions
 {
+    //
+    // Approximate functions (*Fast, *Table) compute exact ones in Exact mode, which is used to validate
+    //      a network trained or evaluated with approximations without changing the code.
+    //
+    enum class ApproximationMode
+    {
+        Approximate,
+        Exact
+    };
+
+    void SetApproximationMode(ApproximationMode mode);
+    ApproximationMode GetApproximationMode();
+
     template<typename T>
     T Linear(T x);
     template<typename T>
@@ -26,6 +39,24 @@ namespace NeuralNetwork::Math::Functions
     template<typename T>
     T HyperbolicTangentDerivativeOptimized(T y);
 
+    template<typename T>
+    T SigmoidFast(T x);
+    template<typename T>
+    T SigmoidFastDerivative(T x);
+    template<typename T>
+    T SigmoidTable(T x);
+    template<typename T>
+    T SigmoidTableDerivative(T x);
+
+    template<typename T>
+    T HyperbolicTangentFast(T x);
+    template<typename T>
+    T HyperbolicTangentFastDerivative(T x);
+    template<typename T>
+    T HyperbolicTangentTable(T x);
+    template<typename T>
+    T HyperbolicTangentTableDerivative(T x);
+
     template<typename T>
     T ReLU(T x);
     template<typename T>
@@ -0,0 +1,377 @@
+#include "kernel_tuning.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <iterator>
+
+#include "math/matrix.h"
+#include "math/functions.h"
+#include "math/random.h"
+
+namespace NeuralNetwork::Math
+{
+    namespace
+    {
+        // Profile loaded by the first kernel of the process
+        const char ProfileEnvironmentVariable[] = "NN_KERNEL_PROFILE";
+        const char ProfileMagic[] = "NeuralNetworkKernelProfile";
+        constexpr int ProfileVersion = 1;
+
+        // Splitting must be faster by this factor, so measurement noise doesn't enable it
+        constexpr double ParallelSpeedupMargin = 0.9;
+
+        const int BlockRowsCandidates[] = { 8, 16, 32, 64, 128 };
+        const int BlockColsCandidates[] = { 64, 128, 256, 512, 1024 };
+        const int BlockInnerCandidates[] = { 32, 64, 128, 256, 512 };
+
+        void ValidateKernelParameters(const KernelParameters& parameters)
+        {
+            if (parameters.multBlockRows < 1 || parameters.multBlockCols < 1 || parameters.multBlockInner < 1)
+                throw std::invalid_argument("Block sizes must be positive");
+
+            if (parameters.multParallelThreshold < 0 || parameters.elementwiseParallelThreshold < 0)
+                throw std::invalid_argument("Parallel thresholds must be non-negative");
+        }
+
+        //
+        // Parameters are read by every kernel, possibly while they are changed by another thread,
+        //      so each one is a separate atomic.
+        //
+        struct ParametersStorage
+        {
+            std::atomic<int> multBlockRows;
+            std::atomic<int> multBlockCols;
+            std::atomic<int> multBlockInner;
+            std::atomic<long long> multParallelThreshold;
+            std::atomic<long long> elementwiseParallelThreshold;
+
+            ParametersStorage()
+            {
+                Store(KernelParameters());
+
+                // An invalid profile must not break kernels, default parameters are kept
+                const char* path = std::getenv(ProfileEnvironmentVariable);
+                KernelParameters parameters;
+                try
+                {
+                    if (path != nullptr && LoadKernelProfile(path, parameters))
+                        Store(parameters);
+                }
+                catch (const std::exception&)
+                {
+                }
+            }
+
+            void Store(const KernelParameters& parameters)
+            {
+                multBlockRows.store(parameters.multBlockRows, std::memory_order_relaxed);
+                multBlockCols.store(parameters.multBlockCols, std::memory_order_relaxed);
+                multBlockInner.store(parameters.multBlockInner, std::memory_order_relaxed);
+                multParallelThreshold.store(parameters.multParallelThreshold, std::memory_order_relaxed);
+                elementwiseParallelThreshold.store(parameters.elementwiseParallelThreshold, std::memory_order_relaxed);
+            }
+
+            KernelParameters Load() const
+            {
+                KernelParameters parameters;
+                parameters.multBlockRows = multBlockRows.load(std::memory_order_relaxed);
+                parameters.multBlockCols = multBlockCols.load(std::memory_order_relaxed);
+                parameters.multBlockInner = multBlockInner.load(std::memory_order_relaxed);
+                parameters.multParallelThreshold = multParallelThreshold.load(std::memory_order_relaxed);
+                parameters.elementwiseParallelThreshold = elementwiseParallelThreshold.load(std::memory_order_relaxed);
+                return parameters;
+            }
+        };
+
+        ParametersStorage& GetStorage()
+        {
+            static ParametersStorage storage;
+            return storage;
+        }
+
+        //
+        // Returns the shortest time of @repetitions runs of @run in seconds.
+        //
+        double Measure(int repetitions, const std::function<void()>& run)
+        {
+            double best = std::numeric_limits<double>::max();
+            for (int i = 0; i < repetitions; i++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                run();
+                best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            }
+            return best;
+        }
+
+        //
+        // Returns the smallest of @sizes from which @parallel runs are faster than @serial ones, -1 when they never are.
+        //
+        long long FindParallelThreshold(const std::vector<long long>& sizes, const std::function<double(long long, bool)>& measure)
+        {
+            long long threshold = -1;
+            for (long long size : sizes)
+            {
+                bool isParallelFaster = measure(size, true) < ParallelSpeedupMargin * measure(size, false);
+                if (!isParallelFaster)
+                    threshold = -1;
+                else if (threshold < 0)
+                    threshold = size;
+            }
+            return threshold;
+        }
+    }
+
+    KernelParameters GetKernelParameters()
+    {
+        return GetStorage().Load();
+    }
+
+    void SetKernelParameters(const KernelParameters& parameters)
+    {
+        ValidateKernelParameters(parameters);
+        GetStorage().Store(parameters);
+    }
+
+    //
+    // Benchmarks Matrix kernels on this CPU, sets the fastest parameters and returns them.
+    // Block sizes are chosen one at a time (columns, inner dimension, rows) for the sum of times of the three
+    //      multiplication kernels on one thread. Parallel thresholds are the smallest sizes from which splitting
+    //      on the default thread pool stays faster than the calling thread alone: square multiplications for
+    //      kernels of multiplication, ApplyFunction() with Sigmoid for element-wise kernels.
+    // Takes a few seconds, see LoadOrTuneKernelProfile() to tune once per machine.
+    //
+    KernelParameters TuneKernelParameters(const KernelTuningOptions& options)
+    {
+        if (options.matrixSize < 16)
+            throw std::invalid_argument("Matrix size of tuning must be at least 16");
+
+        if (options.repetitions < 1)
+            throw std::invalid_argument("Repetitions count must be positive");
+
+        // Kernels run with candidate parameters while tuning, the original ones are restored on failure
+        KernelParameters original = GetKernelParameters();
+        KernelParameters best = original;
+        try
+        {
+            int size = options.matrixSize;
+            Matrix<float> lhv(size, size, false);
+            Matrix<float> rhv(size, size, false);
+            Matrix<float> result(size, size, false);
+            Random::FillUniform(lhv, 0, size, 0, 0, -1.0f, 1.0f);
+            Random::FillUniform(rhv, 0, size, 0, 1, -1.0f, 1.0f);
+
+            best.multParallelThreshold = std::numeric_limits<long long>::max();
+            best.elementwiseParallelThreshold = std::numeric_limits<long long>::max();
+
+            auto measureMultiplications = [&options, &lhv, &rhv, &result](const KernelParameters& parameters)
+            {
+                SetKernelParameters(parameters);
+                return Measure(options.repetitions, [&lhv, &rhv, &result]()
+                    {
+                        result.MultAndStoreThis(lhv, rhv);
+                        Matrix<float>::MultTransposedToMatrixAndStoreTo(lhv, rhv, result);
+                        Matrix<float>::MultMatrixToTransposedAndStoreTo(lhv, rhv, result);
+                    });
+            };
+
+            auto tuneBlock = [&best, &measureMultiplications](int KernelParameters::* block, const int* candidates, int candidatesCount)
+            {
+                double bestTime = std::numeric_limits<double>::max();
+                KernelParameters parameters = best;
+                for (int i = 0; i < candidatesCount; i++)
+                {
+                    parameters.*block = candidates[i];
+                    double time = measureMultiplications(parameters);
+                    if (time < bestTime)
+                    {
+                        bestTime = time;
+                        best.*block = candidates[i];
+                    }
+                }
+            };
+
+            tuneBlock(&KernelParameters::multBlockCols, BlockColsCandidates, std::size(BlockColsCandidates));
+            tuneBlock(&KernelParameters::multBlockInner, BlockInnerCandidates, std::size(BlockInnerCandidates));
+            tuneBlock(&KernelParameters::multBlockRows, BlockRowsCandidates, std::size(BlockRowsCandidates));
+
+            std::vector<long long> multSizes;
+            for (long long side = 16; side <= size; side *= 2)
+            {
+                multSizes.push_back(side);
+            }
+            long long multThreshold = FindParallelThreshold(multSizes, [&options, &best](long long side, bool parallel)
+                {
+                    KernelParameters parameters = best;
+                    parameters.multParallelThreshold = parallel ? 0 : std::numeric_limits<long long>::max();
+                    SetKernelParameters(parameters);
+
+                    int rows = static_cast<int>(side);
+                    Matrix<float> lhv(rows, rows);
+                    Matrix<float> rhv(rows, rows);
+                    Matrix<float> result(rows, rows, false);
+                    return Measure(options.repetitions, [&lhv, &rhv, &result]() { result.MultAndStoreThis(lhv, rhv); });
+                });
+            best.multParallelThreshold = multThreshold < 0 ? std::numeric_limits<long long>::max() : multThreshold * multThreshold * multThreshold;
+
+            std::vector<long long> elementwiseSizes;
+            for (long long count = 1 << 10; count <= 1 << 22; count *= 4)
+            {
+                elementwiseSizes.push_back(count);
+            }
+            long long elementwiseThreshold = FindParallelThreshold(elementwiseSizes, [&options, &best](long long count, bool parallel)
+                {
+                    KernelParameters parameters = best;
+                    parameters.elementwiseParallelThreshold = parallel ? 0 : std::numeric_limits<long long>::max();
+                    SetKernelParameters(parameters);
+
+                    Matrix<float> values(static_cast<int>(count), 1);
+                    return Measure(options.repetitions, [&values]() { values.ApplyFunction(Functions::Sigmoid<float>); });
+                });
+            best.elementwiseParallelThreshold = elementwiseThreshold < 0 ? std::numeric_limits<long long>::max() : elementwiseThreshold;
+        }
+        catch (...)
+        {
+            SetKernelParameters(original);
+            throw;
+        }
+
+        SetKernelParameters(best);
+        return best;
+    }
+
+    //
+    // Identifies the machine a profile was tuned on: CPU model and hardware threads count.
+    //
+    std::string GetKernelProfileSignature()
+    {
+        std::string model = "unknown";
+        std::ifstream cpuInfo("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(cpuInfo, line))
+        {
+            if (line.rfind("model name", 0) == 0 && line.find(':') != std::string::npos)
+            {
+                model = line.substr(line.find(':') + 1);
+                model.erase(0, model.find_first_not_of(' '));
+                break;
+            }
+        }
+        return model + ", " + std::to_string(std::thread::hardware_concurrency()) + " threads";
+    }
+
+    //
+    // Profile is a text file: magic and version, signature of the machine, then one parameter per line.
+    // It is written to a temporary file and renamed, so concurrently started processes never read a partial profile.
+    //
+    void SaveKernelProfile(const std::string& path, const KernelParameters& parameters)
+    {
+        ValidateKernelParameters(parameters);
+
+        std::string temporaryPath = path + ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::trunc);
+            if (!file)
+                throw std::runtime_error("Failed to open kernel profile: " + temporaryPath);
+
+            file << ProfileMagic << ' ' << ProfileVersion << '\n';
+            file << "signature " << GetKernelProfileSignature() << '\n';
+            file << "multBlockRows " << parameters.multBlockRows << '\n';
+            file << "multBlockCols " << parameters.multBlockCols << '\n';
+            file << "multBlockInner " << parameters.multBlockInner << '\n';
+            file << "multParallelThreshold " << parameters.multParallelThreshold << '\n';
+            file << "elementwiseParallelThreshold " << parameters.elementwiseParallelThreshold << '\n';
+
+            file.close();
+            if (!file)
+                throw std::runtime_error("Failed to write kernel profile: " + temporaryPath);
+        }
+        std::filesystem::rename(temporaryPath, path);
+    }
+
+    //
+    // Reads @parameters from the profile at @path. Returns false when there is no profile or it was tuned on another machine.
+    //
+    bool LoadKernelProfile(const std::string& path, KernelParameters& parameters)
+    {
+        std::ifstream file(path);
+        if (!file)
+            return false;
+
+        std::string magic;
+        int version;
+        if (!(file >> magic >> version) || magic != ProfileMagic)
+            throw std::runtime_error("Not a kernel profile: " + path);
+
+        if (version != ProfileVersion)
+            throw std::runtime_error("Unsupported kernel profile version: " + path);
+
+        KernelParameters loaded;
+        bool isSignatureMatched = false;
+        std::string line;
+        std::getline(file, line);
+        while (std::getline(file, line))
+        {
+            std::istringstream stream(line);
+            std::string key;
+            stream >> key;
+            if (key == "signature")
+            {
+                isSignatureMatched = line.substr(key.size() + 1) == GetKernelProfileSignature();
+                continue;
+            }
+
+            long long value;
+            if (!(stream >> value))
+                throw std::runtime_error("Invalid value of " + key + " in kernel profile: " + path);
+
+            if (key == "multBlockRows")
+                loaded.multBlockRows = static_cast<int>(value);
+            else if (key == "multBlockCols")
+                loaded.multBlockCols = static_cast<int>(value);
+            else if (key == "multBlockInner")
+                loaded.multBlockInner = static_cast<int>(value);
+            else if (key == "multParallelThreshold")
+                loaded.multParallelThreshold = value;
+            else if (key == "elementwiseParallelThreshold")
+                loaded.elementwiseParallelThreshold = value;
+        }
+
+        if (!isSignatureMatched)
+            return false;
+
+        ValidateKernelParameters(loaded);
+        parameters = loaded;
+        return true;
+    }
+
+    //
+    // Sets parameters from the profile at @path, or tunes them and saves the profile when there is no profile
+    //      for this machine. Only the first process on a machine pays for tuning.
+    // Processes can also load a profile at startup without code changes: the first kernel reads
+    //      the profile named by NN_KERNEL_PROFILE environment variable.
+    //
+    KernelParameters LoadOrTuneKernelProfile(const std::string& path, const KernelTuningOptions& options)
+    {
+        KernelParameters parameters;
+        if (LoadKernelProfile(path, parameters))
+        {
+            SetKernelParameters(parameters);
+            return parameters;
+        }
+
+        parameters = TuneKernelParameters(options);
+        SaveKernelProfile(path, parameters);
+        return parameters;
+    }
+}
\ No newline at end of file
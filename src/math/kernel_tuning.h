@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+
+namespace NeuralNetwork::Math
+{
+    //
+    // Blocking and threading parameters of Matrix kernels. Results of the kernels don't depend on them:
+    //      every element is summed in the same order for any block sizes and threads count.
+    //
+    struct KernelParameters
+    {
+        // Block of matrix multiplication: rows of the result, its columns and the inner dimension
+        int multBlockRows = 32;
+        int multBlockCols = 256;
+        int multBlockInner = 128;
+        // Multiplications with fewer multiply-adds and element-wise operations with fewer elements
+        //      run on the calling thread, larger ones are split by rows on the default thread pool
+        long long multParallelThreshold = 1LL << 21;
+        long long elementwiseParallelThreshold = 1LL << 18;
+    };
+
+    struct KernelTuningOptions
+    {
+        // Size of square matrices multiplied to measure block sizes
+        int matrixSize = 384;
+        // The fastest of @repetitions runs is taken for every candidate
+        int repetitions = 3;
+    };
+
+    KernelParameters GetKernelParameters();
+    void SetKernelParameters(const KernelParameters& parameters);
+
+    KernelParameters TuneKernelParameters(const KernelTuningOptions& options = KernelTuningOptions());
+
+    std::string GetKernelProfileSignature();
+    void SaveKernelProfile(const std::string& path, const KernelParameters& parameters);
+    bool LoadKernelProfile(const std::string& path, KernelParameters& parameters);
+    KernelParameters LoadOrTuneKernelProfile(const std::string& path, const KernelTuningOptions& options = KernelTuningOptions());
+}
\ No newline at end of file
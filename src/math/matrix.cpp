@@ -2,17 +2,369 @@
 
 #include <stdexcept>
 #include <iomanip>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <functional>
+
+#include "memory/allocator.h"
+#include "math/kernel_tuning.h"
+#include "threading/thread_pool.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define _NN_NPY_MMAP
+#endif
 
 namespace NeuralNetwork::Math
 {
+    namespace
+    {
+        enum class NpyType
+        {
+            Float32,
+            Float64,
+            Int32,
+            Int64,
+            UInt8
+        };
+
+        struct NpyHeader
+        {
+            NpyType type;
+            int elementSize;
+            bool fortranOrder;
+            int rows;
+            int cols;
+        };
+
+        const char NpyMagic[] = "\x93NUMPY";
+        constexpr int NpyPreambleSize = 8;
+
+        bool IsLittleEndianHost()
+        {
+            std::uint16_t value = 1;
+            return *reinterpret_cast<const std::uint8_t*>(&value) == 1;
+        }
+
+        //
+        // Checks magic and version of the first NpyPreambleSize bytes, returns size of the header length field.
+        //
+        int ParseNpyPreamble(const char* preamble)
+        {
+            if (std::memcmp(preamble, NpyMagic, 6) != 0)
+                throw std::runtime_error("Not a .npy file");
+
+            int majorVersion = static_cast<unsigned char>(preamble[6]);
+            if (majorVersion < 1 || majorVersion > 3)
+                throw std::runtime_error("Unsupported .npy version");
+
+            return majorVersion == 1 ? 2 : 4;
+        }
+
+        std::size_t ParseNpyHeaderLength(const char* field, int fieldSize)
+        {
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(field);
+            std::size_t length = 0;
+            for (int i = fieldSize - 1; i >= 0; i--)
+            {
+                length = (length << 8) | bytes[i];
+            }
+            return length;
+        }
+
+        std::string GetNpyValue(const std::string& header, const std::string& key)
+        {
+            std::size_t position = header.find("'" + key + "'");
+            if (position == std::string::npos)
+                throw std::runtime_error("Key '" + key + "' not found in .npy header");
+
+            position = header.find(':', position);
+            if (position == std::string::npos)
+                throw std::runtime_error("Malformed .npy header");
+
+            std::size_t valueStart = header.find_first_not_of(' ', position + 1);
+            if (valueStart == std::string::npos)
+                throw std::runtime_error("Malformed .npy header");
+
+            std::size_t end = header.find(header[valueStart] == '(' ? ')' : ',', valueStart);
+            if (end == std::string::npos)
+                throw std::runtime_error("Malformed .npy header");
+            if (header[valueStart] == '(')
+                end++;
+
+            std::string value = header.substr(position + 1, end - position - 1);
+            value.erase(0, value.find_first_not_of(" '"));
+            value.erase(value.find_last_not_of(" '") + 1);
+            return value;
+        }
+
+        //
+        // Parses the header dictionary. One-dimensional arrays of N elements are loaded as (N x 1) column vectors,
+        //      scalars as (1 x 1) matrices.
+        //
+        NpyHeader ParseNpyHeader(const std::string& header)
+        {
+            NpyHeader result;
+
+            std::string descr = GetNpyValue(header, "descr");
+            bool isLittleEndian = descr[0] == '<' || (descr[0] == '|' && descr.size() == 3 && descr[2] == '1');
+            if (!isLittleEndian || !IsLittleEndianHost())
+                throw std::runtime_error("Only little-endian .npy data is supported");
+
+            std::string type = descr.substr(1);
+            if (type == "f4")
+                result.type = NpyType::Float32, result.elementSize = 4;
+            else if (type == "f8")
+                result.type = NpyType::Float64, result.elementSize = 8;
+            else if (type == "i4")
+                result.type = NpyType::Int32, result.elementSize = 4;
+            else if (type == "i8")
+                result.type = NpyType::Int64, result.elementSize = 8;
+            else if (type == "u1")
+                result.type = NpyType::UInt8, result.elementSize = 1;
+            else
+                throw std::runtime_error("Unsupported .npy type " + descr);
+
+            result.fortranOrder = GetNpyValue(header, "fortran_order") == "True";
+
+            std::string shape = GetNpyValue(header, "shape");
+            std::vector<long long> dimensions;
+            for (std::size_t position = 0; position < shape.size();)
+            {
+                position = shape.find_first_of("0123456789", position);
+                if (position == std::string::npos)
+                    break;
+
+                std::size_t end = shape.find_first_not_of("0123456789", position);
+                dimensions.push_back(std::stoll(shape.substr(position, end - position)));
+                position = end;
+            }
+
+            if (dimensions.size() > 2)
+                throw std::runtime_error("Only .npy arrays with at most two dimensions are supported");
+
+            dimensions.resize(2, 1);
+            if (dimensions[0] > INT32_MAX || dimensions[1] > INT32_MAX)
+                throw std::runtime_error("Dimensions of .npy array are too large");
+
+            result.rows = dimensions[0];
+            result.cols = dimensions[1];
+            return result;
+        }
+
+        template<typename T, typename U>
+        void ConvertNpyData(const char* source, std::size_t count, T* destination)
+        {
+            for (std::size_t i = 0; i < count; i++)
+            {
+                U value;
+                std::memcpy(&value, source + i * sizeof(U), sizeof(U));
+                destination[i] = static_cast<T>(value);
+            }
+        }
+
+        template<typename T>
+        void ConvertNpyData(const NpyHeader& header, const char* source, std::size_t count, T* destination)
+        {
+            switch (header.type)
+            {
+            case NpyType::Float32:
+                ConvertNpyData<T, float>(source, count, destination);
+                break;
+            case NpyType::Float64:
+                ConvertNpyData<T, double>(source, count, destination);
+                break;
+            case NpyType::Int32:
+                ConvertNpyData<T, std::int32_t>(source, count, destination);
+                break;
+            case NpyType::Int64:
+                ConvertNpyData<T, std::int64_t>(source, count, destination);
+                break;
+            case NpyType::UInt8:
+                ConvertNpyData<T, std::uint8_t>(source, count, destination);
+                break;
+            }
+        }
+
+        template<typename T>
+        bool IsNpyTypeOf(const NpyHeader& header)
+        {
+            return (header.type == NpyType::Float32 && std::is_same_v<T, float>) ||
+                (header.type == NpyType::Float64 && std::is_same_v<T, double>);
+        }
+
+        //
+        // Assigns the array from @data: converts elements to T and transposes column-major (Fortran order) data.
+        //
+        template<typename T>
+        void AssignNpyData(Matrix<T>& matrix, const NpyHeader& header, const char* data)
+        {
+            std::size_t count = static_cast<std::size_t>(header.rows) * header.cols;
+            if (!header.fortranOrder)
+            {
+                if (matrix.GetRows() != header.rows || matrix.GetCols() != header.cols)
+                    matrix = Matrix<T>(header.rows, header.cols, false);
+                if (count > 0)
+                    ConvertNpyData(header, data, count, &matrix(0, 0));
+                return;
+            }
+
+            Matrix<T> transposed(header.cols, header.rows, false);
+            if (count > 0)
+                ConvertNpyData(header, data, count, &transposed(0, 0));
+            matrix = transposed.Transpose();
+        }
+
+        // Products with fewer result columns are computed as dot products, accumulated in registers
+        constexpr int DotProductColsLimit = 4;
+        // Elements of one task of element-wise kernels
+        constexpr int ElementsBlockSize = 1 << 12;
+
+        //
+        // Calls @body for row ranges [begin, end) of a product with @multiplyAddsCount multiply-adds,
+        //      on the default thread pool when it reaches multParallelThreshold.
+        //
+        void ForEachRowsRange(const KernelParameters& parameters, int rows, long long multiplyAddsCount, const std::function<void(int, int)>& body)
+        {
+            if (multiplyAddsCount < parameters.multParallelThreshold || rows <= parameters.multBlockRows)
+            {
+                body(0, rows);
+                return;
+            }
+            Threading::ThreadPool::GetDefault().ParallelFor(0, rows, parameters.multBlockRows, body);
+        }
+
+        //
+        // Calls @body for ranges [begin, end) of @count elements, on the default thread pool when there are
+        //      at least elementwiseParallelThreshold elements.
+        //
+        template<typename Body>
+        void ForEachElementsRange(std::size_t count, const Body& body)
+        {
+            if (static_cast<long long>(count) < GetKernelParameters().elementwiseParallelThreshold || count <= ElementsBlockSize)
+            {
+                body(0, count);
+                return;
+            }
+
+            int blocksCount = static_cast<int>((count + ElementsBlockSize - 1) / ElementsBlockSize);
+            Threading::ThreadPool::GetDefault().ParallelFor(0, blocksCount, 1, [&body, count](int begin, int end)
+                {
+                    body(static_cast<std::size_t>(begin) * ElementsBlockSize, std::min(static_cast<std::size_t>(end) * ElementsBlockSize, count));
+                });
+        }
+
+        //
+        // Rows [rowBegin, rowEnd) of @result = lhv * rhv. Element (row, k) of lhv is lhv[row * lhvRowStep + k * lhvInnerStep],
+        //      rhv is row-major (inner x cols). Blocks keep a part of rhv in cache while it is used by rows of the block.
+        // Every element is accumulated over k in increasing order, as by a dot product, so block sizes don't change results.
+        //
+        template<typename T>
+        void MultiplyRows(const KernelParameters& parameters, int rowBegin, int rowEnd, int cols, int inner,
+            const T* lhv, std::size_t lhvRowStep, std::size_t lhvInnerStep, const T* rhv, T* result)
+        {
+            if (cols < DotProductColsLimit)
+            {
+                for (int row = rowBegin; row < rowEnd; row++)
+                {
+                    const T* lhvRow = lhv + row * lhvRowStep;
+                    for (int col = 0; col < cols; col++)
+                    {
+                        T sum = 0;
+                        for (int k = 0; k < inner; k++)
+                        {
+                            sum += lhvRow[k * lhvInnerStep] * rhv[static_cast<std::size_t>(k) * cols + col];
+                        }
+                        result[static_cast<std::size_t>(row) * cols + col] = sum;
+                    }
+                }
+                return;
+            }
+
+            std::fill(result + static_cast<std::size_t>(rowBegin) * cols, result + static_cast<std::size_t>(rowEnd) * cols, static_cast<T>(0));
+            for (int blockRow = rowBegin; blockRow < rowEnd; blockRow += parameters.multBlockRows)
+            {
+                int blockRowEnd = std::min(blockRow + parameters.multBlockRows, rowEnd);
+                for (int blockInner = 0; blockInner < inner; blockInner += parameters.multBlockInner)
+                {
+                    int blockInnerEnd = std::min(blockInner + parameters.multBlockInner, inner);
+                    for (int blockCol = 0; blockCol < cols; blockCol += parameters.multBlockCols)
+                    {
+                        int blockColEnd = std::min(blockCol + parameters.multBlockCols, cols);
+                        for (int row = blockRow; row < blockRowEnd; row++)
+                        {
+                            T* resultRow = result + static_cast<std::size_t>(row) * cols;
+                            for (int k = blockInner; k < blockInnerEnd; k++)
+                            {
+                                T value = lhv[row * lhvRowStep + k * lhvInnerStep];
+                                const T* rhvRow = rhv + static_cast<std::size_t>(k) * cols;
+                                for (int col = blockCol; col < blockColEnd; col++)
+                                {
+                                    resultRow[col] += value * rhvRow[col];
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        //
+        // Rows [rowBegin, rowEnd) of @result = lhv * rhv^T, lhv is row-major (rows x inner), rhv is row-major (cols x inner).
+        //      Elements are dot products of rows, blocks of rhv rows are reused by all rows of a block of lhv.
+        // Param @addToResult adds the product to @result instead of storing it.
+        //
+        template<typename T>
+        void MultiplyRowsByTransposed(const KernelParameters& parameters, int rowBegin, int rowEnd, int cols, int inner,
+            const T* lhv, const T* rhv, T* result, bool addToResult)
+        {
+            if (!addToResult)
+                std::fill(result + static_cast<std::size_t>(rowBegin) * cols, result + static_cast<std::size_t>(rowEnd) * cols, static_cast<T>(0));
+            for (int blockRow = rowBegin; blockRow < rowEnd; blockRow += parameters.multBlockRows)
+            {
+                int blockRowEnd = std::min(blockRow + parameters.multBlockRows, rowEnd);
+                for (int blockCol = 0; blockCol < cols; blockCol += parameters.multBlockCols)
+                {
+                    int blockColEnd = std::min(blockCol + parameters.multBlockCols, cols);
+                    for (int blockInner = 0; blockInner < inner; blockInner += parameters.multBlockInner)
+                    {
+                        int blockInnerEnd = std::min(blockInner + parameters.multBlockInner, inner);
+                        for (int row = blockRow; row < blockRowEnd; row++)
+                        {
+                            const T* lhvRow = lhv + static_cast<std::size_t>(row) * inner;
+                            T* resultRow = result + static_cast<std::size_t>(row) * cols;
+                            for (int col = blockCol; col < blockColEnd; col++)
+                            {
+                                const T* rhvRow = rhv + static_cast<std::size_t>(col) * inner;
+                                T sum = resultRow[col];
+                                for (int k = blockInner; k < blockInnerEnd; k++)
+                                {
+                                    sum += lhvRow[k] * rhvRow[k];
+                                }
+                                resultRow[col] = sum;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
     template<typename T>
-    Matrix<T>::Matrix() : _rows(1), _cols(1), _matrix(nullptr)
+    Matrix<T>::Matrix() : _rows(1), _cols(1), _matrix(nullptr), _data(nullptr)
     {
         AllocMatrix();
     }
 
     template<typename T>
-    Matrix<T>::Matrix(int rows, int cols, bool fillZero) : _rows(rows), _cols(cols), _matrix(nullptr)
+    Matrix<T>::Matrix(int rows, int cols, bool fillZero) : _rows(rows), _cols(cols), _matrix(nullptr), _data(nullptr)
     {
         AllocMatrix();
 
@@ -21,7 +373,7 @@ namespace NeuralNetwork::Math
     }
 
     template<typename T>
-    Matrix<T>::Matrix(int rows, int cols, T** data) : _rows(rows), _cols(cols), _matrix(nullptr)
+    Matrix<T>::Matrix(int rows, int cols, T** data) : _rows(rows), _cols(cols), _matrix(nullptr), _data(nullptr)
     {
         AllocMatrix();
 
@@ -35,7 +387,7 @@ namespace NeuralNetwork::Math
     }
 
     template<typename T>
-    Matrix<T>::Matrix(std::initializer_list<std::initializer_list<T>> init_list) : _matrix(nullptr)
+    Matrix<T>::Matrix(std::initializer_list<std::initializer_list<T>> init_list) : _matrix(nullptr), _data(nullptr)
     {
         _rows = init_list.size();
         _cols = init_list.begin()->size();
@@ -58,6 +410,7 @@ namespace NeuralNetwork::Math
         int new_cols = init_list.begin()->size();
         if (new_rows != _rows || new_cols != _cols)
         {
+            FreeMatrix();
             _rows = new_rows;
             _cols = new_cols;
             AllocMatrix();
@@ -75,25 +428,20 @@ namespace NeuralNetwork::Math
     }
 
     template<typename T>
-    Matrix<T>::Matrix(const Matrix& other) : _rows(other._rows), _cols(other._cols), _matrix(nullptr)
+    Matrix<T>::Matrix(const Matrix& other) : _rows(other._rows), _cols(other._cols), _matrix(nullptr), _data(nullptr)
     {
         AllocMatrix();
 
-        for (int row = 0; row < _rows; row++)
-        {
-            for (int col = 0; col < _cols; col++)
-            {
-                _matrix[row][col] = other._matrix[row][col];
-            }
-        }
+        std::copy(other._data, other._data + static_cast<std::size_t>(_rows) * _cols, _data);
     }
     
     template<typename T>
-    Matrix<T>::Matrix(Matrix&& other) noexcept : _rows(other._rows), _cols(other._cols), _matrix(other._matrix)
+    Matrix<T>::Matrix(Matrix&& other) noexcept : _rows(other._rows), _cols(other._cols), _matrix(other._matrix), _data(other._data)
     {
         other._rows = 0;
         other._cols = 0;
         other._matrix = nullptr;
+        other._data = nullptr;
     }
 
     template<typename T>
@@ -136,13 +484,13 @@ namespace NeuralNetwork::Math
         if (_rows != other._rows || _cols != other._cols)
             throw std::invalid_argument("Rows and Columns not equal");
 
-        for (int row = 0; row < _rows; row++)
-        {
-            for (int col = 0; col < _cols; col++)
+        ForEachElementsRange(static_cast<std::size_t>(_rows) * _cols, [this, &other](std::size_t begin, std::size_t end)
             {
-                _matrix[row][col] *= other._matrix[row][col];
-            }
-        }
+                for (std::size_t i = begin; i < end; i++)
+                {
+                    _data[i] *= other._data[i];
+                }
+            });
         return *this;
     }
 
@@ -158,6 +506,32 @@ namespace NeuralNetwork::Math
         return _cols;
     }
 
+    //
+    // Returns size in bytes of the elements.
+    //
+    template<typename T>
+    std::size_t Matrix<T>::GetElementsSize(int rows, int cols)
+    {
+        return sizeof(T) * rows * cols;
+    }
+
+    //
+    // Returns size in bytes of memory allocated besides the elements: the row pointers table and the allocation header.
+    //
+    template<typename T>
+    std::size_t Matrix<T>::GetOverheadSize(int rows, int cols)
+    {
+        return GetRowPointersSize(rows, cols) + Memory::GetAllocationOverhead();
+    }
+
+    template<typename T>
+    std::size_t Matrix<T>::GetRowPointersSize(int rows, int cols)
+    {
+        // Rounded to the cache line to keep the elements aligned
+        std::size_t size = sizeof(T*) * std::max(rows, cols);
+        return (size + 63) / 64 * 64;
+    }
+
     template<typename T>
     Matrix<T>& Matrix<T>::Fill(T value)
     {
@@ -174,30 +548,21 @@ namespace NeuralNetwork::Math
     template<typename T>
     Matrix<T> Matrix<T>::Transpose() const
     {
-        Matrix<T> outMatrix(_cols, _rows);
-        for (int row = 0; row < _rows; row++)
-        {
-            for (int col = 0; col < _cols; col++)
-            {
-                outMatrix._matrix[row][col] = _matrix[col][row];
-            }
-        }
+        Matrix<T> outMatrix(_cols, _rows, false);
+        TransposeBlock(_data, _cols, outMatrix._data, outMatrix._cols, _rows, _cols);
         return outMatrix;
     }
 
+    //
+    // Square matrices are transposed by swapping tiles, rectangular ones by following cycles of the permutation.
+    //
     template<typename T>
     Matrix<T>& Matrix<T>::TransposeThis()
     {
-        if (_rows != _cols)
-            throw std::invalid_argument("Matrix is not square");
-
-        for (int row = 0; row < _rows - 1; row++)
-        {
-            for (int col = row + 1; col < _cols; col++)
-            {
-                std::swap(_matrix[row][col], _matrix[col][row]);
-            }
-        }
+        if (_rows == _cols)
+            TransposeSquareThis();
+        else
+            TransposeRectangularThis();
         return *this;
     }
 
@@ -207,21 +572,18 @@ namespace NeuralNetwork::Math
         if (lhv._cols != rhv._rows)
             throw std::invalid_argument("The number of columns of the left matrix must be equal to the number of rows of the right matrix for multiplication.");
 
-        if (_rows != lhv._rows && _cols != rhv._cols)
+        if (_rows != lhv._rows || _cols != rhv._cols)
             throw std::invalid_argument("Size of matrix after multiply not equal size of current matrix");
 
-        for (int row = 0; row < _rows; row++)
-        {
-            for (int col = 0; col < _cols; col++)
+        if (_rows == 0 || _cols == 0)
+            return *this;
+
+        KernelParameters parameters = GetKernelParameters();
+        int inner = lhv._cols;
+        ForEachRowsRange(parameters, _rows, static_cast<long long>(_rows) * _cols * inner, [this, &parameters, &lhv, &rhv, inner](int begin, int end)
             {
-                T sum = 0;
-                for (int k = 0; k < lhv._cols; k++)
-                {
-                    sum += lhv._matrix[row][k] * rhv._matrix[k][col];
-                }
-                _matrix[row][col] = sum;
-            }
-        }
+                MultiplyRows(parameters, begin, end, _cols, inner, lhv._data, inner, 1, rhv._data, _data);
+            });
         return *this;
     }
 
@@ -244,13 +606,13 @@ namespace NeuralNetwork::Math
     template<typename T>
     Matrix<T>& Matrix<T>::ApplyFunction(T(*func)(T))
     {
-        for (int row = 0; row < _rows; row++)
-        {
-            for (int col = 0; col < _cols; col++)
+        ForEachElementsRange(static_cast<std::size_t>(_rows) * _cols, [this, func](std::size_t begin, std::size_t end)
             {
-                _matrix[row][col] = func(_matrix[row][col]);
-            }
-        }
+                for (std::size_t i = begin; i < end; i++)
+                {
+                    _data[i] = func(_data[i]);
+                }
+            });
         return *this;
     }
 
@@ -280,6 +642,41 @@ namespace NeuralNetwork::Math
         return *this;
     }
 
+    template<typename T>
+    Matrix<T>& Matrix<T>::AddToEachCol(const Matrix<T>& col)
+    {
+        if (_rows != col._rows)
+            throw std::invalid_argument("Rows count not match");
+
+        for (int row = 0; row < _rows; row++)
+        {
+            T value = col._matrix[row][0];
+            for (int c = 0; c < _cols; c++)
+            {
+                _matrix[row][c] += value;
+            }
+        }
+        return *this;
+    }
+
+    template<typename T>
+    Matrix<T>& Matrix<T>::SumColsAndStoreThis(const Matrix<T>& matrix)
+    {
+        if (_rows != matrix._rows || _cols != 1)
+            throw std::invalid_argument("Size of matrix after summation not equal size of current matrix");
+
+        for (int row = 0; row < _rows; row++)
+        {
+            T sum = 0;
+            for (int col = 0; col < matrix._cols; col++)
+            {
+                sum += matrix._matrix[row][col];
+            }
+            _matrix[row][0] = sum;
+        }
+        return *this;
+    }
+
     template<typename T>
     T& Matrix<T>::operator()(int row, int col)
     {
@@ -300,18 +697,13 @@ namespace NeuralNetwork::Math
 
         if (_rows != other._rows || _cols != other._cols)
         {
+            FreeMatrix();
             _rows = other._rows;
             _cols = other._cols;
             AllocMatrix();
         }
 
-        for (int row = 0; row < _rows; row++)
-        {
-            for (int col = 0; col < _cols; col++)
-            {
-                _matrix[row][col] = other._matrix[row][col];
-            }
-        }
+        std::copy(other._data, other._data + static_cast<std::size_t>(_rows) * _cols, _data);
         return *this;
     }
 
@@ -326,10 +718,12 @@ namespace NeuralNetwork::Math
         _rows = other._rows;
         _cols = other._cols;
         _matrix = other._matrix;
+        _data = other._data;
 
         other._rows = 0;
         other._cols = 0;
         other._matrix = nullptr;
+        other._data = nullptr;
 
         return *this;
     }
@@ -357,13 +751,13 @@ namespace NeuralNetwork::Math
         if (_rows != other._rows || _cols != other._cols)
             throw std::invalid_argument("Matrices must have the same dimensions for addition.");
 
-        for (int row = 0; row < _rows; row++)
-        {
-            for (int col = 0; col < _cols; col++)
+        ForEachElementsRange(static_cast<std::size_t>(_rows) * _cols, [this, &other](std::size_t begin, std::size_t end)
             {
-                _matrix[row][col] += other._matrix[row][col];
-            }
-        }
+                for (std::size_t i = begin; i < end; i++)
+                {
+                    _data[i] += other._data[i];
+                }
+            });
         return *this;
     }
 
@@ -390,13 +784,13 @@ namespace NeuralNetwork::Math
         if (_rows != other._rows || _cols != other._cols)
             throw std::invalid_argument("Matrices must have the same dimensions for substraction.");
 
-        for (int row = 0; row < _rows; row++)
-        {
-            for (int col = 0; col < _cols; col++)
+        ForEachElementsRange(static_cast<std::size_t>(_rows) * _cols, [this, &other](std::size_t begin, std::size_t end)
             {
-                _matrix[row][col] -= other._matrix[row][col];
-            }
-        }
+                for (std::size_t i = begin; i < end; i++)
+                {
+                    _data[i] -= other._data[i];
+                }
+            });
         return *this;
     }
 
@@ -439,13 +833,13 @@ namespace NeuralNetwork::Math
     template<typename T>
     Matrix<T>& Matrix<T>::operator*=(T value)
     {
-        for (int row = 0; row < _rows; row++)
-        {
-            for (int col = 0; col < _cols; col++)
+        ForEachElementsRange(static_cast<std::size_t>(_rows) * _cols, [this, value](std::size_t begin, std::size_t end)
             {
-                _matrix[row][col] *= value;
-            }
-        }
+                for (std::size_t i = begin; i < end; i++)
+                {
+                    _data[i] *= value;
+                }
+            });
         return *this;
     }
 
@@ -466,14 +860,193 @@ namespace NeuralNetwork::Math
     template<typename T>
     Matrix<T>& Matrix<T>::operator/=(T value)
     {
-        for (int row = 0; row < _rows; row++)
+        ForEachElementsRange(static_cast<std::size_t>(_rows) * _cols, [this, value](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t i = begin; i < end; i++)
+                {
+                    _data[i] /= value;
+                }
+            });
+        return *this;
+    }
+
+    //
+    // Binary format: rows and columns count as 32-bit integers followed by elements in row-major order.
+    //
+    template<typename T>
+    void Matrix<T>::WriteBinary(std::ostream& stream) const
+    {
+        std::int32_t dimensions[2] = { _rows, _cols };
+        stream.write(reinterpret_cast<const char*>(dimensions), sizeof(dimensions));
+        stream.write(reinterpret_cast<const char*>(_data), sizeof(T) * _rows * _cols);
+
+        if (!stream)
+            throw std::runtime_error("Failed to write matrix");
+    }
+
+    template<typename T>
+    void Matrix<T>::ReadBinary(std::istream& stream)
+    {
+        std::int32_t dimensions[2];
+        stream.read(reinterpret_cast<char*>(dimensions), sizeof(dimensions));
+        if (!stream || dimensions[0] < 0 || dimensions[1] < 0)
+            throw std::runtime_error("Failed to read matrix dimensions");
+
+        if (dimensions[0] != _rows || dimensions[1] != _cols)
         {
-            for (int col = 0; col < _cols; col++)
+            FreeMatrix();
+            _rows = dimensions[0];
+            _cols = dimensions[1];
+            AllocMatrix();
+        }
+
+        stream.read(reinterpret_cast<char*>(_data), sizeof(T) * _rows * _cols);
+
+        if (!stream)
+            throw std::runtime_error("Failed to read matrix");
+    }
+
+    //
+    // Writes the matrix in NumPy .npy format (version 1.0, C order, little-endian float32 or float64).
+    //
+    template<typename T>
+    void Matrix<T>::WriteNpy(std::ostream& stream) const
+    {
+        if (!IsLittleEndianHost())
+            throw std::runtime_error("Only little-endian .npy data is supported");
+
+        std::string header = std::string("{'descr': '<") + (sizeof(T) == 4 ? "f4" : "f8") +
+            "', 'fortran_order': False, 'shape': (" + std::to_string(_rows) + ", " + std::to_string(_cols) + "), }";
+        // Data is aligned to 64 bytes: preamble, 2 bytes of header length, header padded with spaces and '\n'
+        std::size_t headerLength = header.size() + 1;
+        headerLength += (64 - (NpyPreambleSize + 2 + headerLength) % 64) % 64;
+        header.resize(headerLength - 1, ' ');
+        header += '\n';
+
+        unsigned char lengthField[2] = { static_cast<unsigned char>(headerLength & 0xFF), static_cast<unsigned char>(headerLength >> 8) };
+        stream.write(NpyMagic, 6);
+        stream.put(1);
+        stream.put(0);
+        stream.write(reinterpret_cast<const char*>(lengthField), sizeof(lengthField));
+        stream.write(header.data(), header.size());
+        stream.write(reinterpret_cast<const char*>(_data), sizeof(T) * _rows * _cols);
+
+        if (!stream)
+            throw std::runtime_error("Failed to write .npy data");
+    }
+
+    //
+    // Reads a .npy array of float32, float64, int32, int64 or uint8 elements with at most two dimensions,
+    //      elements are converted to T. Data of matching type and order is read directly to the matrix.
+    //
+    template<typename T>
+    void Matrix<T>::ReadNpy(std::istream& stream)
+    {
+        char preamble[NpyPreambleSize];
+        stream.read(preamble, sizeof(preamble));
+        if (!stream)
+            throw std::runtime_error("Failed to read .npy preamble");
+
+        int lengthFieldSize = ParseNpyPreamble(preamble);
+        char lengthField[4];
+        stream.read(lengthField, lengthFieldSize);
+        std::string headerText(ParseNpyHeaderLength(lengthField, lengthFieldSize), '\0');
+        stream.read(&headerText[0], headerText.size());
+        if (!stream)
+            throw std::runtime_error("Failed to read .npy header");
+
+        NpyHeader header = ParseNpyHeader(headerText);
+        std::size_t count = static_cast<std::size_t>(header.rows) * header.cols;
+        if (IsNpyTypeOf<T>(header) && !header.fortranOrder)
+        {
+            if (_rows != header.rows || _cols != header.cols)
             {
-                _matrix[row][col] /= value;
+                FreeMatrix();
+                _rows = header.rows;
+                _cols = header.cols;
+                AllocMatrix();
             }
+            stream.read(reinterpret_cast<char*>(_data), sizeof(T) * count);
         }
-        return *this;
+        else
+        {
+            std::vector<char> data(count * header.elementSize);
+            stream.read(data.data(), data.size());
+            AssignNpyData(*this, header, data.data());
+        }
+
+        if (!stream)
+            throw std::runtime_error("Failed to read .npy data");
+    }
+
+    template<typename T>
+    void Matrix<T>::SaveNpy(const std::string& path) const
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file)
+            throw std::runtime_error("Failed to open file " + path);
+
+        WriteNpy(file);
+    }
+
+    //
+    // Loads a .npy file. On POSIX systems the file is memory-mapped and the data is converted
+    //      straight from the mapping, other systems read it with ReadNpy().
+    //
+    template<typename T>
+    void Matrix<T>::LoadNpy(const std::string& path)
+    {
+#ifdef _NN_NPY_MMAP
+        int file = open(path.c_str(), O_RDONLY);
+        if (file < 0)
+            throw std::runtime_error("Failed to open file " + path);
+
+        struct stat fileStat;
+        if (fstat(file, &fileStat) != 0 || fileStat.st_size < NpyPreambleSize + 2)
+        {
+            close(file);
+            throw std::runtime_error("Failed to read .npy file " + path);
+        }
+
+        std::size_t size = fileStat.st_size;
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (mapping == MAP_FAILED)
+            throw std::runtime_error("Failed to map file " + path);
+        madvise(mapping, size, MADV_SEQUENTIAL);
+
+        try
+        {
+            const char* bytes = static_cast<const char*>(mapping);
+            int lengthFieldSize = ParseNpyPreamble(bytes);
+            std::size_t dataOffset = NpyPreambleSize + lengthFieldSize;
+            if (dataOffset > size)
+                throw std::runtime_error("Failed to read .npy header");
+
+            std::size_t headerLength = ParseNpyHeaderLength(bytes + NpyPreambleSize, lengthFieldSize);
+            if (dataOffset + headerLength > size)
+                throw std::runtime_error("Failed to read .npy header");
+
+            NpyHeader header = ParseNpyHeader(std::string(bytes + dataOffset, headerLength));
+            dataOffset += headerLength;
+            if (size - dataOffset < static_cast<std::size_t>(header.rows) * header.cols * header.elementSize)
+                throw std::runtime_error("Failed to read .npy data");
+
+            AssignNpyData(*this, header, bytes + dataOffset);
+        }
+        catch (...)
+        {
+            munmap(mapping, size);
+            throw;
+        }
+        munmap(mapping, size);
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("Failed to open file " + path);
+
+        ReadNpy(file);
+#endif
     }
 
     template<typename T>
@@ -485,18 +1058,15 @@ namespace NeuralNetwork::Math
         if (storeTo._rows != lhv._cols || storeTo._cols != rhv._cols)
             throw std::invalid_argument("Size of result matrix not equal size of matrix after multiplication.");
 
-        for (int row = 0; row < storeTo._rows; row++)
-        {
-            for (int col = 0; col < storeTo._cols; col++)
+        if (storeTo._rows == 0 || storeTo._cols == 0)
+            return;
+
+        KernelParameters parameters = GetKernelParameters();
+        int inner = lhv._rows;
+        ForEachRowsRange(parameters, storeTo._rows, static_cast<long long>(storeTo._rows) * storeTo._cols * inner, [&parameters, &lhv, &rhv, &storeTo, inner](int begin, int end)
             {
-                T sum = 0;
-                for (int k = 0; k < lhv._rows; k++)
-                {
-                    sum += lhv._matrix[k][row] * rhv._matrix[k][col];
-                }
-                storeTo._matrix[row][col] = sum;
-            }
-        }
+                MultiplyRows(parameters, begin, end, storeTo._cols, inner, lhv._data, 1, lhv._cols, rhv._data, storeTo._data);
+            });
     }
 
     template<typename T>
@@ -508,18 +1078,73 @@ namespace NeuralNetwork::Math
         if (storeTo._rows != lhv._rows || storeTo._cols != rhv._rows)
             throw std::invalid_argument("Size of result matrix not equal size of matrix after multiplication.");
 
-        for (int row = 0; row < storeTo._rows; row++)
+        if (storeTo._rows == 0 || storeTo._cols == 0)
+            return;
+
+        KernelParameters parameters = GetKernelParameters();
+        int inner = lhv._cols;
+        ForEachRowsRange(parameters, storeTo._rows, static_cast<long long>(storeTo._rows) * storeTo._cols * inner, [&parameters, &lhv, &rhv, &storeTo, inner](int begin, int end)
+            {
+                MultiplyRowsByTransposed(parameters, begin, end, storeTo._cols, inner, lhv._data, rhv._data, storeTo._data, false);
+            });
+    }
+
+    //
+    // addTo += lhv * rhv^T without a temporary matrix, used to accumulate gradients of weights over samples.
+    //
+    template<typename T>
+    void Matrix<T>::MultMatrixToTransposedAndAddTo(const Matrix<T>& lhv, const Matrix<T>& rhv, Matrix<T>& addTo)
+    {
+        if (lhv._cols != rhv._cols)
+            throw std::invalid_argument("The number of columns of the left matrix must be equal to the number of columns of the right matrix for multiplication.");
+
+        if (addTo._rows != lhv._rows || addTo._cols != rhv._rows)
+            throw std::invalid_argument("Size of result matrix not equal size of matrix after multiplication.");
+
+        if (addTo._rows == 0 || addTo._cols == 0)
+            return;
+
+        KernelParameters parameters = GetKernelParameters();
+        int inner = lhv._cols;
+        ForEachRowsRange(parameters, addTo._rows, static_cast<long long>(addTo._rows) * addTo._cols * inner, [&parameters, &lhv, &rhv, &addTo, inner](int begin, int end)
+            {
+                MultiplyRowsByTransposed(parameters, begin, end, addTo._cols, inner, lhv._data, rhv._data, addTo._data, true);
+            });
+    }
+
+    //
+    // Computes @batchCount row-major products storeTo_b = lhv_b * rhv_b, where lhv_b is (@rows x @inner),
+    //      rhv_b is (@inner x @cols) and the matrices of batch b start at b * stride of the corresponding array.
+    // A right matrix shared by the batch (@rhvStride = 0) with packed left matrices and results is computed as
+    //      one product of the stacked left matrices. Rows of all products are split between threads together.
+    //
+    template<typename T>
+    void Matrix<T>::MultStridedBatched(int batchCount, int rows, int cols, int inner,
+        const T* lhv, std::size_t lhvStride, const T* rhv, std::size_t rhvStride, T* storeTo, std::size_t storeToStride)
+    {
+        if (batchCount <= 0 || rows == 0 || cols == 0)
+            return;
+
+        if (rhvStride == 0 && lhvStride == static_cast<std::size_t>(rows) * inner && storeToStride == static_cast<std::size_t>(rows) * cols)
         {
-            for (int col = 0; col < storeTo._cols; col++)
+            rows *= batchCount;
+            batchCount = 1;
+        }
+
+        KernelParameters parameters = GetKernelParameters();
+        int totalRows = batchCount * rows;
+        ForEachRowsRange(parameters, totalRows, static_cast<long long>(totalRows) * cols * inner,
+            [&parameters, batchCount, rows, cols, inner, lhv, lhvStride, rhv, rhvStride, storeTo, storeToStride](int begin, int end)
             {
-                T sum = 0;
-                for (int k = 0; k < lhv._cols; k++)
+                for (int row = begin; row < end;)
                 {
-                    sum += lhv._matrix[row][k] * rhv._matrix[col][k];
+                    int batch = row / rows;
+                    int batchRowEnd = std::min(end, (batch + 1) * rows);
+                    MultiplyRows(parameters, row - batch * rows, batchRowEnd - batch * rows, cols, inner,
+                        lhv + batch * lhvStride, inner, 1, rhv + batch * rhvStride, storeTo + batch * storeToStride);
+                    row = batchRowEnd;
                 }
-                storeTo._matrix[row][col] = sum;
-            }
-        }
+            });
     }
 
     template<typename T>
@@ -528,11 +1153,13 @@ namespace NeuralNetwork::Math
         if (_matrix != nullptr)
             FreeMatrix();
 
-        _matrix = new T*[_rows];
-        for (int row = 0; row < _rows; row++)
-        {
-            _matrix[row] = new T[_cols];
-        }
+        // The row pointers table is placed before the elements in the same allocation. It has room for
+        //      max(rows, cols) pointers, so in-place transposition of rectangular matrices keeps the block.
+        std::size_t rowPointersSize = GetRowPointersSize(_rows, _cols);
+        char* block = static_cast<char*>(Memory::Allocate(rowPointersSize + sizeof(T) * _rows * _cols));
+        _matrix = reinterpret_cast<T**>(block);
+        _data = reinterpret_cast<T*>(block + rowPointersSize);
+        UpdateRowPointers();
     }
 
     template<typename T>
@@ -541,13 +1168,143 @@ namespace NeuralNetwork::Math
         if (_matrix == nullptr)
             return;
 
+        Memory::Free(_matrix);
+
+        _matrix = nullptr;
+        _data = nullptr;
+    }
+
+    template<typename T>
+    void Matrix<T>::UpdateRowPointers()
+    {
         for (int row = 0; row < _rows; row++)
         {
-            delete[] _matrix[row];
+            _matrix[row] = _data + static_cast<std::size_t>(row) * _cols;
         }
-        delete[] _matrix;
+    }
 
-        _matrix = nullptr;
+    //
+    // Cache-oblivious transposition of the (@rows x @cols) block: the longer side is halved until
+    //      the block fits TransposeBlockSize, then the block is transposed tile by tile.
+    //
+    template<typename T>
+    void Matrix<T>::TransposeBlock(const T* source, int sourceStride, T* destination, int destinationStride, int rows, int cols)
+    {
+        if (rows <= TransposeBlockSize && cols <= TransposeBlockSize)
+        {
+            for (int row = 0; row < rows; row += TransposeTileSize)
+            {
+                for (int col = 0; col < cols; col += TransposeTileSize)
+                {
+                    TransposeTile(source + static_cast<std::size_t>(row) * sourceStride + col, sourceStride,
+                        destination + static_cast<std::size_t>(col) * destinationStride + row, destinationStride,
+                        std::min(TransposeTileSize, rows - row), std::min(TransposeTileSize, cols - col));
+                }
+            }
+            return;
+        }
+
+        if (rows >= cols)
+        {
+            int half = rows / 2;
+            TransposeBlock(source, sourceStride, destination, destinationStride, half, cols);
+            TransposeBlock(source + static_cast<std::size_t>(half) * sourceStride, sourceStride, destination + half, destinationStride, rows - half, cols);
+        }
+        else
+        {
+            int half = cols / 2;
+            TransposeBlock(source, sourceStride, destination, destinationStride, rows, half);
+            TransposeBlock(source + half, sourceStride, destination + static_cast<std::size_t>(half) * destinationStride, destinationStride, rows, cols - half);
+        }
+    }
+
+    //
+    // Full tiles go through a local buffer with constant bounds, so the compiler keeps the tile in registers
+    //      and vectorizes both the load of source rows and the store of destination rows.
+    //
+    template<typename T>
+    void Matrix<T>::TransposeTile(const T* source, int sourceStride, T* destination, int destinationStride, int rows, int cols)
+    {
+        if (rows == TransposeTileSize && cols == TransposeTileSize)
+        {
+            T tile[TransposeTileSize][TransposeTileSize];
+            for (int row = 0; row < TransposeTileSize; row++)
+            {
+                for (int col = 0; col < TransposeTileSize; col++)
+                {
+                    tile[col][row] = source[static_cast<std::size_t>(row) * sourceStride + col];
+                }
+            }
+            for (int col = 0; col < TransposeTileSize; col++)
+            {
+                for (int row = 0; row < TransposeTileSize; row++)
+                {
+                    destination[static_cast<std::size_t>(col) * destinationStride + row] = tile[col][row];
+                }
+            }
+            return;
+        }
+
+        for (int row = 0; row < rows; row++)
+        {
+            for (int col = 0; col < cols; col++)
+            {
+                destination[static_cast<std::size_t>(col) * destinationStride + row] = source[static_cast<std::size_t>(row) * sourceStride + col];
+            }
+        }
+    }
+
+    template<typename T>
+    void Matrix<T>::TransposeSquareThis()
+    {
+        for (int rowBlock = 0; rowBlock < _rows; rowBlock += TransposeBlockSize)
+        {
+            int rowEnd = std::min(rowBlock + TransposeBlockSize, _rows);
+            for (int colBlock = rowBlock; colBlock < _cols; colBlock += TransposeBlockSize)
+            {
+                int colEnd = std::min(colBlock + TransposeBlockSize, _cols);
+                for (int row = rowBlock; row < rowEnd; row++)
+                {
+                    for (int col = std::max(colBlock, row + 1); col < colEnd; col++)
+                    {
+                        std::swap(_matrix[row][col], _matrix[col][row]);
+                    }
+                }
+            }
+        }
+    }
+
+    //
+    // Element with linear index i moves to (i * rows) mod (size - 1), the permutation is applied cycle by cycle.
+    // Visited elements are marked in a bit set, so the extra memory is one bit per element.
+    //
+    template<typename T>
+    void Matrix<T>::TransposeRectangularThis()
+    {
+        std::size_t size = static_cast<std::size_t>(_rows) * _cols;
+        if (size > 2)
+        {
+            std::size_t modulus = size - 1;
+            std::vector<bool> visited(size, false);
+            for (std::size_t start = 1; start < modulus; start++)
+            {
+                if (visited[start])
+                    continue;
+
+                std::size_t index = start;
+                T value = _data[start];
+                do
+                {
+                    std::size_t next = index * _rows % modulus;
+                    std::swap(_data[next], value);
+                    visited[index] = true;
+                    index = next;
+                } while (index != start);
+            }
+        }
+
+        std::swap(_rows, _cols);
+        UpdateRowPointers();
     }
 
     template<typename T>
@@ -1,11 +1,18 @@
 #pragma once
 
 #include <iostream>
+#include <cstddef>
+#include <string>
 #include <initializer_list>
 #include <iterator>
 
 namespace NeuralNetwork::Math
 {
+    //
+    // Dense row-major matrix. Elements are stored in one contiguous block, _matrix is the table of row pointers into it.
+    // The table and the elements share one allocation by Memory::Allocate(), so NUMA binding and huge pages follow
+    //      the allocation policy.
+    //
     template<typename T>
     class Matrix
     {
@@ -13,6 +20,11 @@ namespace NeuralNetwork::Math
         int _rows;
         int _cols;
         T** _matrix;
+        T* _data;
+
+        // Side of the tile transposed through a local buffer, recursive transposition splits blocks down to it
+        static constexpr int TransposeTileSize = 8;
+        static constexpr int TransposeBlockSize = 32;
 
     public:
         Matrix();
@@ -33,6 +45,9 @@ namespace NeuralNetwork::Math
         int GetRows() const;
         int GetCols() const;
 
+        static std::size_t GetElementsSize(int rows, int cols);
+        static std::size_t GetOverheadSize(int rows, int cols);
+
         Matrix<T>& Fill(T value);
 
         Matrix<T> HadamardProduct(const Matrix<T>& other) const;
@@ -48,6 +63,8 @@ namespace NeuralNetwork::Math
 
         Matrix<T>& AddRow(const Matrix<T>& row, int rowIndex);
         Matrix<T>& AddCol(const Matrix<T>& col, int colIndex);
+        Matrix<T>& AddToEachCol(const Matrix<T>& col);
+        Matrix<T>& SumColsAndStoreThis(const Matrix<T>& matrix);
 
         T& operator()(int row, int col);
         const T& operator()(int row, int col) const;
@@ -65,8 +82,19 @@ namespace NeuralNetwork::Math
         Matrix<T> operator/(T value) const;
         Matrix<T>& operator/=(T value);
 
+        void WriteBinary(std::ostream& stream) const;
+        void ReadBinary(std::istream& stream);
+
+        void WriteNpy(std::ostream& stream) const;
+        void ReadNpy(std::istream& stream);
+        void SaveNpy(const std::string& path) const;
+        void LoadNpy(const std::string& path);
+
         static void MultTransposedToMatrixAndStoreTo(const Matrix<T>& lhv, const Matrix<T>& rhv, Matrix<T>& storeTo);
         static void MultMatrixToTransposedAndStoreTo(const Matrix<T>& lhv, const Matrix<T>& rhv, Matrix<T>& storeTo);
+        static void MultMatrixToTransposedAndAddTo(const Matrix<T>& lhv, const Matrix<T>& rhv, Matrix<T>& addTo);
+        static void MultStridedBatched(int batchCount, int rows, int cols, int inner,
+            const T* lhv, std::size_t lhvStride, const T* rhv, std::size_t rhvStride, T* storeTo, std::size_t storeToStride);
 
         template<typename U>
         friend Matrix<U> operator*(U value, const Matrix<U>& rhv);
@@ -81,5 +109,12 @@ namespace NeuralNetwork::Math
     private:
         void AllocMatrix();
         void FreeMatrix();
+        void UpdateRowPointers();
+        static std::size_t GetRowPointersSize(int rows, int cols);
+
+        static void TransposeBlock(const T* source, int sourceStride, T* destination, int destinationStride, int rows, int cols);
+        static void TransposeTile(const T* source, int sourceStride, T* destination, int destinationStride, int rows, int cols);
+        void TransposeSquareThis();
+        void TransposeRectangularThis();
     };
 }
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "random.h"
+
+#include <cmath>
+
+namespace NeuralNetwork::Math::Random
+{
+    namespace
+    {
+        constexpr std::uint32_t PhiloxM0 = 0xD2511F53;
+        constexpr std::uint32_t PhiloxM1 = 0xCD9E8D57;
+        constexpr std::uint32_t PhiloxW0 = 0x9E3779B9;
+        constexpr std::uint32_t PhiloxW1 = 0xBB67AE85;
+        constexpr int PhiloxRounds = 10;
+
+        // 24 bits are exactly representable in float, result is in [0, 1)
+        template<typename T>
+        T ToUniform(std::uint32_t bits)
+        {
+            return static_cast<T>(bits >> 8) * static_cast<T>(1.0 / 16777216.0);
+        }
+
+        // Result is in (0, 1], so it may be passed to log()
+        template<typename T>
+        T ToUniformPositive(std::uint32_t bits)
+        {
+            return static_cast<T>((bits >> 8) + 1) * static_cast<T>(1.0 / 16777216.0);
+        }
+    }
+
+    //
+    // Counter-based random number generator Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+    // Returns 4 random words for the counter (@counterHigh, @counterLow) and @key,
+    //      so any element of a sequence can be generated independently of the others.
+    //
+    std::array<std::uint32_t, 4> Philox4x32(std::uint64_t counterHigh, std::uint64_t counterLow, std::uint64_t key)
+    {
+        std::uint32_t c0 = static_cast<std::uint32_t>(counterLow);
+        std::uint32_t c1 = static_cast<std::uint32_t>(counterLow >> 32);
+        std::uint32_t c2 = static_cast<std::uint32_t>(counterHigh);
+        std::uint32_t c3 = static_cast<std::uint32_t>(counterHigh >> 32);
+        std::uint32_t k0 = static_cast<std::uint32_t>(key);
+        std::uint32_t k1 = static_cast<std::uint32_t>(key >> 32);
+
+        for (int round = 0; round < PhiloxRounds; round++)
+        {
+            std::uint64_t product0 = static_cast<std::uint64_t>(PhiloxM0) * c0;
+            std::uint64_t product1 = static_cast<std::uint64_t>(PhiloxM1) * c2;
+
+            std::uint32_t hi0 = static_cast<std::uint32_t>(product0 >> 32);
+            std::uint32_t lo0 = static_cast<std::uint32_t>(product0);
+            std::uint32_t hi1 = static_cast<std::uint32_t>(product1 >> 32);
+            std::uint32_t lo1 = static_cast<std::uint32_t>(product1);
+
+            c0 = hi1 ^ c1 ^ k0;
+            c1 = lo1;
+            c2 = hi0 ^ c3 ^ k1;
+            c3 = lo0;
+
+            k0 += PhiloxW0;
+            k1 += PhiloxW1;
+        }
+        return { c0, c1, c2, c3 };
+    }
+
+    //
+    // Fills rows [@rowBegin, @rowEnd) with uniform values in [@lowerBorder, @upperBorder).
+    // Value of element (row, col) depends only on @seed, @stream and its position in the matrix,
+    //      so the matrix may be filled in parallel by row ranges with the same result.
+    //
+    template<typename T>
+    void FillUniform(Matrix<T>& matrix, int rowBegin, int rowEnd, std::uint64_t seed, std::uint64_t stream, T lowerBorder, T upperBorder)
+    {
+        T dist = upperBorder - lowerBorder;
+        std::uint64_t cols = matrix.GetCols();
+
+        for (int row = rowBegin; row < rowEnd; row++)
+        {
+            std::uint64_t element = row * cols;
+            std::array<std::uint32_t, 4> bits = Philox4x32(stream, element / 4, seed);
+            for (int col = 0; col < cols; col++, element++)
+            {
+                if (element % 4 == 0)
+                    bits = Philox4x32(stream, element / 4, seed);
+                // Rounding of the scaled value may reach the upper border, which is excluded
+                T value = ToUniform<T>(bits[element % 4]) * dist + lowerBorder;
+                matrix(row, col) = value < upperBorder ? value : lowerBorder;
+            }
+        }
+    }
+
+    //
+    // Fills rows [@rowBegin, @rowEnd) with normal values using Box-Muller transform.
+    // Has the same reproducibility guarantees as FillUniform().
+    //
+    template<typename T>
+    void FillNormal(Matrix<T>& matrix, int rowBegin, int rowEnd, std::uint64_t seed, std::uint64_t stream, T mean, T deviation)
+    {
+        const T twoPi = static_cast<T>(6.283185307179586);
+        std::uint64_t cols = matrix.GetCols();
+
+        for (int row = rowBegin; row < rowEnd; row++)
+        {
+            std::uint64_t element = row * cols;
+            std::array<std::uint32_t, 4> bits = Philox4x32(stream, element / 4, seed);
+            T radius = 0;
+            T angle = 0;
+            for (int col = 0; col < cols; col++, element++)
+            {
+                if (element % 4 == 0)
+                    bits = Philox4x32(stream, element / 4, seed);
+
+                // Every pair of random words gives a pair of normal values
+                if (element % 2 == 0 || col == 0)
+                {
+                    int pair = element % 4 / 2;
+                    radius = std::sqrt(static_cast<T>(-2.0) * std::log(ToUniformPositive<T>(bits[2 * pair])));
+                    angle = twoPi * ToUniform<T>(bits[2 * pair + 1]);
+                }
+
+                T value = element % 2 == 0 ? radius * std::cos(angle) : radius * std::sin(angle);
+                matrix(row, col) = value * deviation + mean;
+            }
+        }
+    }
+
+    template void FillUniform<float>(Matrix<float>& matrix, int rowBegin, int rowEnd, std::uint64_t seed, std::uint64_t stream, float lowerBorder, float upperBorder);
+    template void FillUniform<double>(Matrix<double>& matrix, int rowBegin, int rowEnd, std::uint64_t seed, std::uint64_t stream, double lowerBorder, double upperBorder);
+
+    template void FillNormal<float>(Matrix<float>& matrix, int rowBegin, int rowEnd, std::uint64_t seed, std::uint64_t stream, float mean, float deviation);
+    template void FillNormal<double>(Matrix<double>& matrix, int rowBegin, int rowEnd, std::uint64_t seed, std::uint64_t stream, double mean, double deviation);
+}
\ No newline at end of file
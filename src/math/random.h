@@ -0,0 +1,16 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "math/matrix.h"
+
+namespace NeuralNetwork::Math::Random
+{
+    std::array<std::uint32_t, 4> Philox4x32(std::uint64_t counterHigh, std::uint64_t counterLow, std::uint64_t key);
+
+    template<typename T>
+    void FillUniform(Matrix<T>& matrix, int rowBegin, int rowEnd, std::uint64_t seed, std::uint64_t stream, T lowerBorder, T upperBorder);
+    template<typename T>
+    void FillNormal(Matrix<T>& matrix, int rowBegin, int rowEnd, std::uint64_t seed, std::uint64_t stream, T mean, T deviation);
+}
\ No newline at end of file
@@ -0,0 +1,342 @@
+#include "allocator.h"
+
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#include <sys/mman.h>
+#define _NN_MEMORY_MMAP
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
+namespace NeuralNetwork::Memory
+{
+    namespace
+    {
+        // The header keeps the data aligned to the cache line
+        constexpr std::size_t HeaderSize = 64;
+        constexpr std::size_t HugePageSize = 2 << 20;
+
+        enum class AllocationKind : std::uint32_t
+        {
+            Heap,
+            Mapped
+        };
+
+        struct AllocationHeader
+        {
+            AllocationKind kind;
+            std::size_t mappedSize;
+            std::size_t size;
+        };
+
+        std::atomic<int> globalNumaNode(-1);
+        std::atomic<HugePages> globalHugePages(HugePages::None);
+        std::atomic<std::size_t> globalLargeAllocationSize(2 << 20);
+        thread_local const AllocationPolicy* threadPolicy = nullptr;
+
+        std::atomic<std::size_t> allocatedSize(0);
+        std::atomic<std::size_t> peakAllocatedSize(0);
+
+        struct Topology
+        {
+            std::vector<int> nodeOfCpu;
+            std::vector<std::vector<int>> cpusOfNode;
+        };
+
+        // Parses lists like "0-3,8-11"
+        std::vector<int> ParseCpuList(const std::string& text)
+        {
+            std::vector<int> values;
+            std::size_t position = 0;
+            while (position < text.size())
+            {
+                std::size_t end = text.find(',', position);
+                std::string range = text.substr(position, end == std::string::npos ? std::string::npos : end - position);
+                std::size_t dash = range.find('-');
+                if (!range.empty() && range.find_first_of("0123456789") != std::string::npos)
+                {
+                    int first = std::stoi(range.substr(0, dash));
+                    int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                    for (int value = first; value <= last; value++)
+                    {
+                        values.push_back(value);
+                    }
+                }
+                if (end == std::string::npos)
+                    break;
+                position = end + 1;
+            }
+            return values;
+        }
+
+        Topology LoadTopology()
+        {
+            Topology topology;
+#ifdef __linux__
+            std::ifstream onlineFile("/sys/devices/system/node/online");
+            std::string online;
+            if (std::getline(onlineFile, online))
+            {
+                for (int node : ParseCpuList(online))
+                {
+                    std::ifstream cpusFile("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+                    std::string cpus;
+                    std::getline(cpusFile, cpus);
+
+                    if (topology.cpusOfNode.size() <= node)
+                        topology.cpusOfNode.resize(node + 1);
+                    topology.cpusOfNode[node] = ParseCpuList(cpus);
+                    for (int cpu : topology.cpusOfNode[node])
+                    {
+                        if (topology.nodeOfCpu.size() <= cpu)
+                            topology.nodeOfCpu.resize(cpu + 1, 0);
+                        topology.nodeOfCpu[cpu] = node;
+                    }
+                }
+            }
+#endif
+            if (topology.cpusOfNode.empty())
+            {
+                int cpusCount = std::max<int>(std::thread::hardware_concurrency(), 1);
+                topology.cpusOfNode.resize(1);
+                for (int cpu = 0; cpu < cpusCount; cpu++)
+                {
+                    topology.cpusOfNode[0].push_back(cpu);
+                }
+                topology.nodeOfCpu.assign(cpusCount, 0);
+            }
+            return topology;
+        }
+
+        const Topology& GetTopology()
+        {
+            static const Topology topology = LoadTopology();
+            return topology;
+        }
+
+        std::size_t RoundUp(std::size_t value, std::size_t alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        void TrackAllocation(std::size_t size)
+        {
+            std::size_t current = allocatedSize.fetch_add(size, std::memory_order_relaxed) + size;
+            std::size_t peak = peakAllocatedSize.load(std::memory_order_relaxed);
+            while (current > peak && !peakAllocatedSize.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+            {
+            }
+        }
+
+#ifdef _NN_MEMORY_MMAP
+        void* MapAligned(std::size_t size, std::size_t alignment)
+        {
+            std::size_t reservedSize = size + alignment;
+            void* reserved = mmap(nullptr, reservedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (reserved == MAP_FAILED)
+                return nullptr;
+
+            std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(reserved);
+            std::uintptr_t aligned = RoundUp(begin, alignment);
+            if (aligned > begin)
+                munmap(reserved, aligned - begin);
+            std::size_t tail = begin + reservedSize - (aligned + size);
+            if (tail > 0)
+                munmap(reinterpret_cast<void*>(aligned + size), tail);
+            return reinterpret_cast<void*>(aligned);
+        }
+
+        //
+        // Maps @size bytes with huge pages as requested by @policy and binds them to its NUMA node.
+        // Binding is done before the first touch, so the pages are allocated on the node.
+        //
+        void* MapPages(std::size_t size, const AllocationPolicy& policy, std::size_t& mappedSize)
+        {
+            void* base = nullptr;
+            bool useHugePages = policy.hugePages != HugePages::None && size >= HugePageSize;
+#ifdef MAP_HUGETLB
+            if (useHugePages && policy.hugePages == HugePages::Explicit)
+            {
+                mappedSize = RoundUp(size, HugePageSize);
+                base = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if (base == MAP_FAILED)
+                    base = nullptr;
+            }
+#endif
+            if (base == nullptr && useHugePages)
+            {
+                // Only the start is aligned: whole 2 MiB extents get huge pages, the tail stays on regular pages
+                mappedSize = RoundUp(size, static_cast<std::size_t>(sysconf(_SC_PAGESIZE)));
+                base = MapAligned(mappedSize, HugePageSize);
+#ifdef MADV_HUGEPAGE
+                if (base != nullptr)
+                    madvise(base, mappedSize, MADV_HUGEPAGE);
+#endif
+            }
+            if (base == nullptr)
+            {
+                mappedSize = RoundUp(size, static_cast<std::size_t>(sysconf(_SC_PAGESIZE)));
+                base = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (base == MAP_FAILED)
+                    throw std::bad_alloc();
+            }
+
+#ifdef __linux__
+            if (policy.numaNode >= 0)
+            {
+                // Preferred policy falls back to other nodes instead of failing when the node is full
+                std::vector<unsigned long> nodeMask(policy.numaNode / (8 * sizeof(unsigned long)) + 1, 0);
+                nodeMask[policy.numaNode / (8 * sizeof(unsigned long))] |= 1UL << (policy.numaNode % (8 * sizeof(unsigned long)));
+                syscall(SYS_mbind, base, mappedSize, MPOL_PREFERRED, nodeMask.data(), nodeMask.size() * 8 * sizeof(unsigned long) + 1, 0);
+            }
+#endif
+            return base;
+        }
+#endif
+    }
+
+    void SetAllocationPolicy(const AllocationPolicy& policy)
+    {
+        globalNumaNode = policy.numaNode;
+        globalHugePages = policy.hugePages;
+        globalLargeAllocationSize = policy.largeAllocationSize;
+    }
+
+    //
+    // Returns the policy of the current thread: the innermost ScopedAllocationPolicy or the global one.
+    //
+    AllocationPolicy GetAllocationPolicy()
+    {
+        if (threadPolicy != nullptr)
+            return *threadPolicy;
+
+        AllocationPolicy policy;
+        policy.numaNode = globalNumaNode;
+        policy.hugePages = globalHugePages;
+        policy.largeAllocationSize = globalLargeAllocationSize;
+        return policy;
+    }
+
+    ScopedAllocationPolicy::ScopedAllocationPolicy(const AllocationPolicy& policy) : _previousPolicy(threadPolicy), _policy(policy)
+    {
+        threadPolicy = &_policy;
+    }
+
+    ScopedAllocationPolicy::~ScopedAllocationPolicy()
+    {
+        threadPolicy = _previousPolicy;
+    }
+
+    void* Allocate(std::size_t size)
+    {
+        std::size_t totalSize = size + HeaderSize;
+#ifdef _NN_MEMORY_MMAP
+        bool isMapped = threadPolicy != nullptr ?
+            threadPolicy->numaNode >= 0 || (threadPolicy->hugePages != HugePages::None && totalSize >= threadPolicy->largeAllocationSize) :
+            globalNumaNode.load(std::memory_order_relaxed) >= 0 ||
+                (globalHugePages.load(std::memory_order_relaxed) != HugePages::None && totalSize >= globalLargeAllocationSize.load(std::memory_order_relaxed));
+        if (isMapped)
+        {
+            std::size_t mappedSize = 0;
+            void* base = MapPages(totalSize, GetAllocationPolicy(), mappedSize);
+            AllocationHeader* header = static_cast<AllocationHeader*>(base);
+            header->kind = AllocationKind::Mapped;
+            header->mappedSize = mappedSize;
+            header->size = totalSize;
+            TrackAllocation(totalSize);
+            return static_cast<char*>(base) + HeaderSize;
+        }
+#endif
+        void* base = ::operator new(totalSize, std::align_val_t(HeaderSize));
+        AllocationHeader* header = static_cast<AllocationHeader*>(base);
+        header->kind = AllocationKind::Heap;
+        header->mappedSize = 0;
+        header->size = totalSize;
+        TrackAllocation(totalSize);
+        return static_cast<char*>(base) + HeaderSize;
+    }
+
+    void Free(void* pointer)
+    {
+        if (pointer == nullptr)
+            return;
+
+        AllocationHeader* header = reinterpret_cast<AllocationHeader*>(static_cast<char*>(pointer) - HeaderSize);
+        allocatedSize.fetch_sub(header->size, std::memory_order_relaxed);
+#ifdef _NN_MEMORY_MMAP
+        if (header->kind == AllocationKind::Mapped)
+        {
+            munmap(header, header->mappedSize);
+            return;
+        }
+#endif
+        ::operator delete(header, std::align_val_t(HeaderSize));
+    }
+
+    //
+    // Returns bytes requested from Allocate() and not freed yet, allocation headers included.
+    // Rounding of mapped allocations to whole pages is not counted.
+    //
+    std::size_t GetAllocatedSize()
+    {
+        return allocatedSize.load(std::memory_order_relaxed);
+    }
+
+    //
+    // Returns the maximum of GetAllocatedSize() since the start or the last call of ResetPeakAllocatedSize().
+    //
+    std::size_t GetPeakAllocatedSize()
+    {
+        return peakAllocatedSize.load(std::memory_order_relaxed);
+    }
+
+    void ResetPeakAllocatedSize()
+    {
+        peakAllocatedSize = allocatedSize.load(std::memory_order_relaxed);
+    }
+
+    //
+    // Returns bytes added to every allocation by Allocate().
+    //
+    std::size_t GetAllocationOverhead()
+    {
+        return HeaderSize;
+    }
+
+    int GetNumaNodesCount()
+    {
+        return GetTopology().cpusOfNode.size();
+    }
+
+    int GetNumaNodeOfCpu(int cpu)
+    {
+        const Topology& topology = GetTopology();
+        return cpu >= 0 && cpu < topology.nodeOfCpu.size() ? topology.nodeOfCpu[cpu] : 0;
+    }
+
+    std::vector<int> GetCpusOfNumaNode(int node)
+    {
+        const Topology& topology = GetTopology();
+        return node >= 0 && node < topology.cpusOfNode.size() ? topology.cpusOfNode[node] : std::vector<int>();
+    }
+
+    int GetCurrentNumaNode()
+    {
+#ifdef __linux__
+        return GetNumaNodeOfCpu(sched_getcpu());
+#else
+        return 0;
+#endif
+    }
+}
\ No newline at end of file
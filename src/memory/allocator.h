@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <new>
+
+namespace NeuralNetwork::Memory
+{
+    enum class HugePages
+    {
+        // Regular pages
+        None,
+        // Transparent huge pages: the mapping is aligned to 2 MiB and marked with madvise(MADV_HUGEPAGE)
+        Transparent,
+        // Pages from the hugetlbfs pool (MAP_HUGETLB), falls back to transparent huge pages when the pool is empty
+        Explicit
+    };
+
+    //
+    // Placement of memory allocated by Allocate(): matrices and packed weights use it.
+    // By default everything comes from the heap, aligned to the cache line. Allocations bound to a NUMA node and,
+    //      when huge pages are enabled, allocations of at least @largeAllocationSize bytes are mapped directly
+    //      from the system instead, so they may be bound to a node and backed by huge pages. Mapping costs
+    //      system calls per allocation, so it is meant for long-lived buffers such as weights.
+    //
+    struct AllocationPolicy
+    {
+        // NUMA node to bind allocations to (preferred policy), -1 keeps first-touch placement
+        int numaNode = -1;
+        HugePages hugePages = HugePages::None;
+        std::size_t largeAllocationSize = 2 << 20;
+    };
+
+    void SetAllocationPolicy(const AllocationPolicy& policy);
+    AllocationPolicy GetAllocationPolicy();
+
+    //
+    // Overrides the allocation policy for the current thread while the object exists.
+    //
+    class ScopedAllocationPolicy
+    {
+    private:
+        const AllocationPolicy* _previousPolicy;
+        AllocationPolicy _policy;
+
+    public:
+        explicit ScopedAllocationPolicy(const AllocationPolicy& policy);
+        ~ScopedAllocationPolicy();
+
+        ScopedAllocationPolicy(const ScopedAllocationPolicy& other) = delete;
+        ScopedAllocationPolicy& operator=(const ScopedAllocationPolicy& other) = delete;
+    };
+
+    void* Allocate(std::size_t size);
+    void Free(void* pointer);
+
+    std::size_t GetAllocatedSize();
+    std::size_t GetPeakAllocatedSize();
+    void ResetPeakAllocatedSize();
+    std::size_t GetAllocationOverhead();
+
+    //
+    // Standard allocator over Allocate() and Free() for containers.
+    //
+    template<typename T>
+    struct Allocator
+    {
+        using value_type = T;
+
+        Allocator() = default;
+        template<typename U>
+        Allocator(const Allocator<U>&) {}
+
+        T* allocate(std::size_t count) { return static_cast<T*>(Allocate(count * sizeof(T))); }
+        void deallocate(T* pointer, std::size_t) { Free(pointer); }
+
+        template<typename U>
+        bool operator==(const Allocator<U>&) const { return true; }
+        template<typename U>
+        bool operator!=(const Allocator<U>&) const { return false; }
+    };
+
+    int GetNumaNodesCount();
+    int GetNumaNodeOfCpu(int cpu);
+    std::vector<int> GetCpusOfNumaNode(int node);
+    int GetCurrentNumaNode();
+}
\ No newline at end of file
@@ -1,11 +1,26 @@
 #include "perceptron.h"
 
 #include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+#include "math/random.h"
+#include "threading/thread_pool.h"
+#include "profiling/tracer.h"
 
 namespace NeuralNetwork
 {
     template<typename T>
-    Perceptron<T>::Perceptron(const std::vector<int>& neuronsCountPerLayer) : _cacheIsInitialized(false)
+    Perceptron<T>::Perceptron(const std::vector<int>& neuronsCountPerLayer) : 
+        _cacheIsInitialized(false), 
+        _checkpointInterval(0),
+        _segmentStart(-1),
+        _activationFunction(nullptr),
+        _derivativeFunction(nullptr),
+        _cacheAfterActivationFunction(false),
+        _inputGradientIsEnabled(false),
+        _gradientAccumulationSteps(1),
+        _accumulatedStepsCount(0)
     {
         if (neuronsCountPerLayer.size() < 1)
             throw std::invalid_argument("Neuron layers count must be more than 1");
@@ -27,29 +42,118 @@ namespace NeuralNetwork
         }
     }
 
+    //
+    // Weights and bias are filled with uniform values in [@lowerBorder, @upperBorder).
+    // Values are generated by counter-based generator, so the result depends only on @seed
+    //      and not on the number of threads used for initialization.
+    //
     template<typename T>
     void Perceptron<T>::RandomizeWeights(unsigned int seed, T lowerBorder, T upperBorder)
     {
-        srand(seed);
-        T dist = upperBorder - lowerBorder;
+        FillParameters([seed, lowerBorder, upperBorder](int, Math::Matrix<T>& matrix, int rowBegin, int rowEnd, std::uint64_t stream)
+            {
+                Math::Random::FillUniform(matrix, rowBegin, rowEnd, seed, stream, lowerBorder, upperBorder);
+            }, true);
+    }
 
-        for (int i = 0; i < _weights.size(); i++)
-        {
-            for (int row = 0; row < _weights[i].GetRows(); row++)
+    //
+    // Initialization schemes (fanIn and fanOut are neurons count of the layers connected by the weights):
+    //      Uniform - U(-scale, scale)
+    //      Normal - N(0, scale^2)
+    //      XavierUniform - U(-a, a), a = scale * sqrt(6 / (fanIn + fanOut))
+    //      XavierNormal - N(0, s^2), s = scale * sqrt(2 / (fanIn + fanOut))
+    //      HeUniform - U(-a, a), a = scale * sqrt(6 / fanIn)
+    //      HeNormal - N(0, s^2), s = scale * sqrt(2 / fanIn)
+    // Bias is set to zero. Layers are initialized in parallel by row tiles with reproducible result.
+    //
+    template<typename T>
+    void Perceptron<T>::InitializeWeights(WeightsInitialization scheme, unsigned long long seed, T scale)
+    {
+        const std::vector<Math::Matrix<T>>& weights = _weights;
+        FillParameters([scheme, seed, scale, &weights](int layerIndex, Math::Matrix<T>& matrix, int rowBegin, int rowEnd, std::uint64_t stream)
             {
-                for (int col = 0; col < _weights[i].GetCols(); col++)
+                T fanIn = static_cast<T>(weights[layerIndex].GetCols());
+                T fanOut = static_cast<T>(weights[layerIndex].GetRows());
+
+                switch (scheme)
+                {
+                case WeightsInitialization::Uniform:
+                    Math::Random::FillUniform(matrix, rowBegin, rowEnd, seed, stream, -scale, scale);
+                    break;
+                case WeightsInitialization::Normal:
+                    Math::Random::FillNormal(matrix, rowBegin, rowEnd, seed, stream, static_cast<T>(0.0), scale);
+                    break;
+                case WeightsInitialization::XavierUniform:
                 {
-                    T randValue = rand() / static_cast<T>(RAND_MAX);
-                    _weights[i](row, col) = randValue * dist + lowerBorder;
+                    T limit = scale * std::sqrt(static_cast<T>(6.0) / (fanIn + fanOut));
+                    Math::Random::FillUniform(matrix, rowBegin, rowEnd, seed, stream, -limit, limit);
+                    break;
                 }
-            }
+                case WeightsInitialization::XavierNormal:
+                    Math::Random::FillNormal(matrix, rowBegin, rowEnd, seed, stream, static_cast<T>(0.0), scale * std::sqrt(static_cast<T>(2.0) / (fanIn + fanOut)));
+                    break;
+                case WeightsInitialization::HeUniform:
+                {
+                    T limit = scale * std::sqrt(static_cast<T>(6.0) / fanIn);
+                    Math::Random::FillUniform(matrix, rowBegin, rowEnd, seed, stream, -limit, limit);
+                    break;
+                }
+                case WeightsInitialization::HeNormal:
+                    Math::Random::FillNormal(matrix, rowBegin, rowEnd, seed, stream, static_cast<T>(0.0), scale * std::sqrt(static_cast<T>(2.0) / fanIn));
+                    break;
+                default:
+                    throw std::invalid_argument("Unknown weights initialization scheme");
+                }
+            }, false);
+
+        for (Math::Matrix<T>& bias : _bias)
+        {
+            bias.Fill(0);
+        }
+    }
 
-            for (int row = 0; row < _bias[i].GetRows(); row++)
+    //
+    // Splits weights (and bias when @fillBias is true) into row tiles and calls @fill for them on the thread pool.
+    // Each matrix has its own random stream: 2 * layerIndex for weights, 2 * layerIndex + 1 for bias.
+    //
+    template<typename T>
+    void Perceptron<T>::FillParameters(const std::function<void(int, Math::Matrix<T>&, int, int, std::uint64_t)>& fill, bool fillBias)
+    {
+        ReleasePackedWeights();
+
+        const int TileSize = 1 << 16;
+
+        struct Tile
+        {
+            int layerIndex;
+            bool isBias;
+            int rowBegin;
+            int rowEnd;
+        };
+
+        std::vector<Tile> tiles;
+        for (int i = 0; i < _weights.size(); i++)
+        {
+            int rowsPerTile = std::max(1, TileSize / _weights[i].GetCols());
+            for (int row = 0; row < _weights[i].GetRows(); row += rowsPerTile)
             {
-                T randValue = rand() / static_cast<T>(RAND_MAX);
-                _bias[i](row, 0) = randValue * dist + lowerBorder;
+                tiles.push_back({ i, false, row, std::min(row + rowsPerTile, _weights[i].GetRows()) });
             }
+
+            if (fillBias)
+                tiles.push_back({ i, true, 0, _bias[i].GetRows() });
         }
+
+        Threading::ThreadPool::GetDefault().ParallelFor(0, tiles.size(), 1, [this, &tiles, &fill](int begin, int end)
+            {
+                for (int tileIndex = begin; tileIndex < end; tileIndex++)
+                {
+                    const Tile& tile = tiles[tileIndex];
+                    Math::Matrix<T>& matrix = tile.isBias ? _bias[tile.layerIndex] : _weights[tile.layerIndex];
+                    std::uint64_t stream = 2 * static_cast<std::uint64_t>(tile.layerIndex) + (tile.isBias ? 1 : 0);
+                    fill(tile.layerIndex, matrix, tile.rowBegin, tile.rowEnd, stream);
+                }
+            });
     }
 
     template<typename T>
@@ -76,44 +180,281 @@ namespace NeuralNetwork
     template<typename T>
     const Math::Matrix<T>& Perceptron<T>::ForwardPropagation(T(*activationFunction)(T))
     {
+        // Activations of a checkpointed segment are overwritten
+        _segmentStart = -1;
+
+        if (!_packedWeights.empty())
+        {
+            for (int i = 0; i < _layers.size() - 1; i++)
+            {
+                const Math::Matrix<T>& input = GetLayer(i);
+                Math::Matrix<T>& output = GetLayer(i + 1);
+                ResizeMatrix(output, GetLayerSize(i + 1), input.GetCols());
+
+                _NN_TRACE_SCOPE("forward", "PackedLayer", i);
+                ForwardPropagationPacked(i, input, output, activationFunction);
+            }
+            return _layers[_layers.size() - 1];
+        }
+
         for (int i = 0; i < _layers.size() - 1; i++)
         {
-            _layers[i + 1]
-                .MultAndStoreThis(_weights[i], _layers[i])
-                .AddCol(_bias[i], 0)
-                .ApplyFunction(activationFunction);
+            Math::Matrix<T>& output = GetLayer(i + 1);
+            ResizeMatrix(output, GetLayerSize(i + 1), 1);
+            {
+                _NN_TRACE_SCOPE("forward", "GEMV", i);
+                output
+                    .MultAndStoreThis(_weights[i], GetLayer(i))
+                    .AddCol(_bias[i], 0);
+            }
+            _NN_TRACE_SCOPE("forward", "Activation", i);
+            output.ApplyFunction(activationFunction);
         }
         return _layers[_layers.size() - 1];
     }
 
+    //
+    // Forward propagation for a batch of samples stored as columns of @inputValues.
+    // Does not change the state of the perceptron, so it may be called concurrently.
+    //
+    template<typename T>
+    Math::Matrix<T> Perceptron<T>::ForwardPropagationBatch(const Math::Matrix<T>& inputValues, T(*activationFunction)(T)) const
+    {
+        if (inputValues.GetRows() != _layers[0].GetRows())
+            throw std::invalid_argument("Rows count of input values not equal neurons count of input layer");
+
+        Math::Matrix<T> outputValues = inputValues;
+        for (int i = 0; i < _weights.size(); i++)
+        {
+            _NN_TRACE_SCOPE("forward", "BatchLayer", i);
+            Math::Matrix<T> layerValues(_weights[i].GetRows(), inputValues.GetCols(), false);
+            if (!_packedWeights.empty())
+            {
+                ForwardPropagationPacked(i, outputValues, layerValues, activationFunction);
+                outputValues = std::move(layerValues);
+                continue;
+            }
+
+            layerValues
+                .MultAndStoreThis(_weights[i], outputValues)
+                .AddToEachCol(_bias[i])
+                .ApplyFunction(activationFunction);
+            outputValues = std::move(layerValues);
+        }
+        return outputValues;
+    }
+
+    //
+    // Packs weights into panels of PackedPanelRows rows stored column by column, so the inference kernel
+    //      reads every panel as one contiguous stream and accumulates PackedPanelRows outputs at once.
+    // With @replicatePerNumaNode every NUMA node gets its own copy bound to its memory and threads read
+    //      the copy of the node they run on.
+    // The packed copy is used by ForwardPropagation() and ForwardPropagationBatch() until the weights change:
+    //      training, initialization and state loading release it, call this method again after them.
+    // Packing again with the same replicas count reuses the existing panels.
+    //
+    template<typename T>
+    void Perceptron<T>::FreezeForInference(bool replicatePerNumaNode)
+    {
+        int replicasCount = replicatePerNumaNode ? Memory::GetNumaNodesCount() : 1;
+        _packedWeights.resize(replicasCount);
+        _packedBias.resize(replicasCount);
+        for (int replica = 0; replica < replicasCount; replica++)
+        {
+            Memory::AllocationPolicy policy = Memory::GetAllocationPolicy();
+            if (replicatePerNumaNode)
+                policy.numaNode = replica;
+            Memory::ScopedAllocationPolicy scopedPolicy(policy);
+
+            _packedWeights[replica].resize(_weights.size());
+            _packedBias[replica].resize(_weights.size());
+            for (int i = 0; i < _weights.size(); i++)
+            {
+                const Math::Matrix<T>& weights = _weights[i];
+                int rows = weights.GetRows();
+                int cols = weights.GetCols();
+                int panelsCount = (rows + PackedPanelRows - 1) / PackedPanelRows;
+
+                std::vector<T, Memory::Allocator<T>>& packedWeights = _packedWeights[replica][i];
+                packedWeights.assign(static_cast<std::size_t>(panelsCount) * PackedPanelRows * cols, static_cast<T>(0.0));
+                for (int row = 0; row < rows; row++)
+                {
+                    T* panel = packedWeights.data() + static_cast<std::size_t>(row / PackedPanelRows) * PackedPanelRows * cols;
+                    for (int col = 0; col < cols; col++)
+                    {
+                        panel[static_cast<std::size_t>(col) * PackedPanelRows + row % PackedPanelRows] = weights(row, col);
+                    }
+                }
+
+                std::vector<T, Memory::Allocator<T>>& packedBias = _packedBias[replica][i];
+                packedBias.assign(static_cast<std::size_t>(panelsCount) * PackedPanelRows, static_cast<T>(0.0));
+                for (int row = 0; row < rows; row++)
+                {
+                    packedBias[row] = _bias[i](row, 0);
+                }
+            }
+        }
+    }
+
+    template<typename T>
+    bool Perceptron<T>::IsFrozenForInference() const
+    {
+        return !_packedWeights.empty();
+    }
+
+    //
+    // Computes layer (@layerIndex + 1) from packed weights for samples stored as columns of @inputValues.
+    // A single sample is a GEMV over the panel, a batch is processed by tiles of PackedPanelSamples samples.
+    //
+    template<typename T>
+    void Perceptron<T>::ForwardPropagationPacked(int layerIndex, const Math::Matrix<T>& inputValues, Math::Matrix<T>& outputValues, T(*activationFunction)(T)) const
+    {
+        int replica = _packedWeights.size() > 1 ? std::min<int>(Memory::GetCurrentNumaNode(), _packedWeights.size() - 1) : 0;
+        const std::vector<T, Memory::Allocator<T>>& packedWeights = _packedWeights[replica][layerIndex];
+        const std::vector<T, Memory::Allocator<T>>& packedBias = _packedBias[replica][layerIndex];
+        int rows = outputValues.GetRows();
+        int cols = inputValues.GetRows();
+        int samplesCount = inputValues.GetCols();
+
+        for (int panelRow = 0; panelRow < rows; panelRow += PackedPanelRows)
+        {
+            const T* panel = packedWeights.data() + static_cast<std::size_t>(panelRow) * cols;
+            const T* bias = packedBias.data() + panelRow;
+            int panelRowsCount = std::min(PackedPanelRows, rows - panelRow);
+
+            if (samplesCount == 1)
+            {
+                T sums[PackedPanelRows] = {};
+                for (int col = 0; col < cols; col++)
+                {
+                    T value = inputValues(col, 0);
+                    const T* weights = panel + static_cast<std::size_t>(col) * PackedPanelRows;
+                    for (int row = 0; row < PackedPanelRows; row++)
+                    {
+                        sums[row] += weights[row] * value;
+                    }
+                }
+
+                for (int row = 0; row < panelRowsCount; row++)
+                {
+                    outputValues(panelRow + row, 0) = activationFunction(sums[row] + bias[row]);
+                }
+                continue;
+            }
+
+            for (int firstSample = 0; firstSample < samplesCount; firstSample += PackedPanelSamples)
+            {
+                int samplesInTile = std::min(PackedPanelSamples, samplesCount - firstSample);
+                T sums[PackedPanelRows][PackedPanelSamples] = {};
+                for (int col = 0; col < cols; col++)
+                {
+                    const T* weights = panel + static_cast<std::size_t>(col) * PackedPanelRows;
+                    const T* values = &inputValues(col, firstSample);
+                    if (samplesInTile == PackedPanelSamples)
+                    {
+                        for (int row = 0; row < PackedPanelRows; row++)
+                        {
+                            for (int sample = 0; sample < PackedPanelSamples; sample++)
+                            {
+                                sums[row][sample] += weights[row] * values[sample];
+                            }
+                        }
+                    }
+                    else
+                    {
+                        for (int row = 0; row < PackedPanelRows; row++)
+                        {
+                            for (int sample = 0; sample < samplesInTile; sample++)
+                            {
+                                sums[row][sample] += weights[row] * values[sample];
+                            }
+                        }
+                    }
+                }
+
+                for (int row = 0; row < panelRowsCount; row++)
+                {
+                    for (int sample = 0; sample < samplesInTile; sample++)
+                    {
+                        outputValues(panelRow + row, firstSample + sample) = activationFunction(sums[row][sample] + bias[row]);
+                    }
+                }
+            }
+        }
+    }
+
+    template<typename T>
+    void Perceptron<T>::ReleasePackedWeights()
+    {
+        _packedWeights.clear();
+        _packedBias.clear();
+    }
+
     //
     // This is forward propagation with saving derivatives for use in backward propagation.
     // Param @cacheAfterActivationFunction is used to save the derivative after the activation function, 
     //      which is helpful for calculating the derivative of the Sigmoid or Hyperbolic Tangent functions.
+    // When checkpointing is enabled (see SetCheckpointInterval()) only activations of segment boundaries and
+    //      activations and derivatives of the last segment are saved, the rest are recomputed segment by segment
+    //      in backward propagation.
     // 
     template<typename T>
     const Math::Matrix<T>& Perceptron<T>::ForwardPropagationWithCache(T(*activationFunction)(T), T(*derivativeFunction)(T), bool cacheAfterActivationFunction)
     {
         if (!_cacheIsInitialized)
-            throw std::exception("Cache is not initialized. Use InitTrainCache() method.");
+            throw std::logic_error("Cache is not initialized. Use InitTrainCache() method.");
 
-        for (int i = 0; i < _layers.size() - 1; i++)
+        _activationFunction = activationFunction;
+        _derivativeFunction = derivativeFunction;
+        _cacheAfterActivationFunction = cacheAfterActivationFunction;
+
+        int weightsCount = _layers.size() - 1;
+        int cachedFrom = 0;
+        if (_checkpointInterval > 0)
+            cachedFrom = (weightsCount - 1) - (weightsCount - 1) % _checkpointInterval;
+
+        for (int i = 0; i < weightsCount; i++)
         {
-            _layers[i + 1]
-                .MultAndStoreThis(_weights[i], _layers[i])
-                .AddCol(_bias[i], 0);
+            // Activations of the segment go to _segmentLayers, the last segment stays there for backward propagation
+            if (_checkpointInterval > 0 && i % _checkpointInterval == 0)
+                _segmentStart = i;
+
+            Math::Matrix<T>& output = GetLayer(i + 1);
+            ResizeMatrix(output, GetLayerSize(i + 1), 1);
+            {
+                _NN_TRACE_SCOPE("forward", "GEMV", i);
+                output
+                    .MultAndStoreThis(_weights[i], GetLayer(i))
+                    .AddCol(_bias[i], 0);
+            }
+
+            if (i < cachedFrom)
+            {
+                _NN_TRACE_SCOPE("forward", "Activation", i);
+                output.ApplyFunction(activationFunction);
+                continue;
+            }
 
+            Math::Matrix<T>& derivative = _derivatives[i - cachedFrom];
             if (cacheAfterActivationFunction)
             {
-                _layers[i + 1].ApplyFunction(activationFunction);
-                _derivatives[i] = _layers[i + 1];
-                _derivatives[i].ApplyFunction(derivativeFunction);
+                {
+                    _NN_TRACE_SCOPE("forward", "Activation", i);
+                    output.ApplyFunction(activationFunction);
+                }
+                _NN_TRACE_SCOPE("forward", "CacheDerivative", i);
+                derivative = output;
+                derivative.ApplyFunction(derivativeFunction);
             }
             else
             {
-                _derivatives[i] = _layers[i + 1];
-                _derivatives[i].ApplyFunction(derivativeFunction);
-                _layers[i + 1].ApplyFunction(activationFunction);
+                {
+                    _NN_TRACE_SCOPE("forward", "CacheDerivative", i);
+                    derivative = output;
+                    derivative.ApplyFunction(derivativeFunction);
+                }
+                _NN_TRACE_SCOPE("forward", "Activation", i);
+                output.ApplyFunction(activationFunction);
             }
         }
         return _layers[_layers.size() - 1];
@@ -148,52 +489,92 @@ namespace NeuralNetwork
     template<typename T>
     void Perceptron<T>::BackwardPropagation(const Math::Matrix<T>& idealValues, T learningRate, T moment)
     {
-        int layerIndex = _layers.size() - 2;
-        _deltas[layerIndex] = _layers[layerIndex + 1];
-        _deltas[layerIndex] -= idealValues;
-        _deltas[layerIndex] *= static_cast<T>(2.0);
-        _deltas[layerIndex].HadamardProductThis(_derivatives[layerIndex]);
+        ReleasePackedWeights();
 
-        Math::Matrix<T>::MultMatrixToTransposedAndStoreTo(_deltas[layerIndex], _layers[layerIndex], _deltasWeights[layerIndex]);
-        _deltasBias[layerIndex] = _deltas[layerIndex];
-
-        _deltasWeightsInertia[layerIndex] *= moment;
-        _deltasBiasInertia[layerIndex] *= moment;
-        _deltasWeights[layerIndex] *= (static_cast<T>(1.0) - moment);
-        _deltasBias[layerIndex] *= (static_cast<T>(1.0) - moment);
-        _deltasWeightsInertia[layerIndex] += _deltasWeights[layerIndex];
-        _deltasBiasInertia[layerIndex] += _deltasBias[layerIndex];
+        int layerIndex = _layers.size() - 2;
+        {
+            _NN_TRACE_SCOPE("backward", "Delta", layerIndex);
+            _deltas[layerIndex] = _layers[layerIndex + 1];
+            _deltas[layerIndex] -= idealValues;
+            _deltas[layerIndex] *= static_cast<T>(2.0);
+            _deltas[layerIndex].HadamardProductThis(GetCachedDerivative(layerIndex));
+        }
+        {
+            _NN_TRACE_SCOPE("backward", "WeightsGradient", layerIndex);
+            AccumulateGradients(layerIndex);
+        }
 
         layerIndex--;
 
         // Hidden layers
         for (; layerIndex >= 0; layerIndex--)
         {
-            Math::Matrix<T>::MultTransposedToMatrixAndStoreTo(_weights[layerIndex + 1], _deltas[layerIndex + 1], _deltas[layerIndex]);
-            _deltas[layerIndex].HadamardProductThis(_derivatives[layerIndex]);
-
-            Math::Matrix<T>::MultMatrixToTransposedAndStoreTo(_deltas[layerIndex], _layers[layerIndex], _deltasWeights[layerIndex]);
-            _deltasBias[layerIndex] = _deltas[layerIndex];
-
-            _deltasWeightsInertia[layerIndex] *= moment;
-            _deltasBiasInertia[layerIndex] *= moment;
-            _deltasWeights[layerIndex] *= (static_cast<T>(1.0) - moment);
-            _deltasBias[layerIndex] *= (static_cast<T>(1.0) - moment);
-            _deltasWeightsInertia[layerIndex] += _deltasWeights[layerIndex];
-            _deltasBiasInertia[layerIndex] += _deltasBias[layerIndex];
+            {
+                _NN_TRACE_SCOPE("backward", "Delta", layerIndex);
+                Math::Matrix<T>::MultTransposedToMatrixAndStoreTo(_weights[layerIndex + 1], _deltas[layerIndex + 1], _deltas[layerIndex]);
+                _deltas[layerIndex].HadamardProductThis(GetCachedDerivative(layerIndex));
+            }
+            _NN_TRACE_SCOPE("backward", "WeightsGradient", layerIndex);
+            AccumulateGradients(layerIndex);
         }
 
-        // Weights adjusting
-        for (int weightIndex = 0; weightIndex < _weights.size(); weightIndex++)
+        if (_inputGradientIsEnabled)
         {
-            _deltasWeights[weightIndex].MultAndStoreThis(_deltasWeightsInertia[weightIndex], learningRate);
-            _deltasBias[weightIndex].MultAndStoreThis(_deltasBiasInertia[weightIndex], learningRate);
+            _NN_TRACE_SCOPE("backward", "InputGradient", 0);
+            if (_inputGradient.GetRows() != _layers[0].GetRows())
+                _inputGradient = Math::Matrix<T>(_layers[0].GetRows(), 1, false);
+            Math::Matrix<T>::MultTransposedToMatrixAndStoreTo(_weights[0], _deltas[0], _inputGradient);
+        }
+
+        _accumulatedStepsCount++;
+        if (_accumulatedStepsCount == _gradientAccumulationSteps)
+            ApplyAccumulatedGradients(learningRate, moment);
+    }
 
-            _weights[weightIndex] -= _deltasWeights[weightIndex];
-            _bias[weightIndex] -= _deltasBias[weightIndex];
+    //
+    // Stores gradients of weights and bias of @layerIndex computed from _deltas, or adds them to the sums
+    //      of previous calls when gradients are accumulated.
+    // Activations of @layerIndex must be loaded, GetCachedDerivative(@layerIndex) loads its segment.
+    //
+    template<typename T>
+    void Perceptron<T>::AccumulateGradients(int layerIndex)
+    {
+        if (_accumulatedStepsCount == 0)
+        {
+            Math::Matrix<T>::MultMatrixToTransposedAndStoreTo(_deltas[layerIndex], GetLayer(layerIndex), _deltasWeights[layerIndex]);
+            _deltasBias[layerIndex] = _deltas[layerIndex];
+        }
+        else
+        {
+            Math::Matrix<T>::MultMatrixToTransposedAndAddTo(_deltas[layerIndex], GetLayer(layerIndex), _deltasWeights[layerIndex]);
+            _deltasBias[layerIndex] += _deltas[layerIndex];
         }
     }
 
+    //
+    // Adjusts weights and bias between layers (@layerIndex) and (@layerIndex + 1) 
+    //      using gradients stored in _deltasWeights and _deltasBias.
+    // Callers release packed weights once before adjusting: trainers call this method from several threads.
+    //
+    template<typename T>
+    void Perceptron<T>::AdjustWeights(int layerIndex, T learningRate, T moment)
+    {
+        _NN_TRACE_SCOPE("backward", "AdjustWeights", layerIndex);
+
+        _deltasWeightsInertia[layerIndex] *= moment;
+        _deltasBiasInertia[layerIndex] *= moment;
+        _deltasWeights[layerIndex] *= (static_cast<T>(1.0) - moment);
+        _deltasBias[layerIndex] *= (static_cast<T>(1.0) - moment);
+        _deltasWeightsInertia[layerIndex] += _deltasWeights[layerIndex];
+        _deltasBiasInertia[layerIndex] += _deltasBias[layerIndex];
+
+        _deltasWeights[layerIndex].MultAndStoreThis(_deltasWeightsInertia[layerIndex], learningRate);
+        _deltasBias[layerIndex].MultAndStoreThis(_deltasBiasInertia[layerIndex], learningRate);
+
+        _weights[layerIndex] -= _deltasWeights[layerIndex];
+        _bias[layerIndex] -= _deltasBias[layerIndex];
+    }
+
     template<typename T>
     void Perceptron<T>::InitTrainCache()
     {
@@ -203,7 +584,8 @@ namespace NeuralNetwork
         _cacheIsInitialized = true;
 
         int layersCount = _layers.size();
-        _derivatives.resize(layersCount - 1);
+        int derivativesCount = GetDerivativesCount();
+        _derivatives.resize(derivativesCount);
         _deltas.resize(layersCount - 1);
         _deltasWeights.resize(layersCount - 1);
         _deltasBias.resize(layersCount - 1);
@@ -212,28 +594,644 @@ namespace NeuralNetwork
 
         for (int i = 0; i < layersCount - 1; i++)
         {
-            int neuronsCountCurrent = _layers[i].GetRows();
-            int neuronsCountNext = _layers[i + 1].GetRows();
+            int neuronsCountCurrent = GetLayerSize(i);
+            int neuronsCountNext = GetLayerSize(i + 1);
 
-            _derivatives[i] = Math::Matrix<T>(_layers[i + 1].GetRows(), 1, false);
-            _deltas[i] = Math::Matrix<T>(_layers[i + 1].GetRows(), 1, false);
+            if (i < derivativesCount)
+                _derivatives[i] = Math::Matrix<T>(neuronsCountNext, 1, false);
+            _deltas[i] = Math::Matrix<T>(neuronsCountNext, 1, false);
             _deltasWeights[i] = Math::Matrix<T>(neuronsCountNext, neuronsCountCurrent, false);
             _deltasBias[i] = Math::Matrix<T>(neuronsCountNext, 1, false);
             _deltasWeightsInertia[i] = Math::Matrix<T>(neuronsCountNext, neuronsCountCurrent);
             _deltasBiasInertia[i] = Math::Matrix<T>(neuronsCountNext, 1);
         }
+        UpdateLayersStorage();
     }
 
     template<typename T>
     void Perceptron<T>::ClearTrainCache()
     {
         _cacheIsInitialized = false;
+        _accumulatedStepsCount = 0;
+        UpdateLayersStorage();
         _derivatives.clear();
         _deltas.clear();
         _deltasWeights.clear();
         _deltasBias.clear();
         _deltasWeightsInertia.clear();
         _deltasBiasInertia.clear();
+        _inputGradient = Math::Matrix<T>();
+    }
+
+    //
+    // Gradient checkpointing: with @interval > 0 the layers are split into segments of @interval layers.
+    //      While the train cache is initialized only activations of segment boundaries (every @interval-th layer,
+    //      the input and the output layers) are kept, activations and derivatives inside segments are kept for
+    //      one segment at a time. Backward propagation recomputes each segment from the activations of its first
+    //      layer, so memory of activations and derivatives is bounded by the boundaries and the largest segment
+    //      instead of the whole network, at the cost of about one more forward propagation.
+    // Param @interval = 0 disables checkpointing (all activations and derivatives are cached).
+    //
+    template<typename T>
+    void Perceptron<T>::SetCheckpointInterval(int interval)
+    {
+        if (interval < 0)
+            throw std::invalid_argument("Checkpoint interval must be non-negative");
+
+        _checkpointInterval = interval;
+        if (!_cacheIsInitialized)
+            return;
+
+        int derivativesCount = GetDerivativesCount();
+        _derivatives.resize(derivativesCount);
+        for (int i = 0; i < derivativesCount; i++)
+        {
+            ResizeMatrix(_derivatives[i], GetLayerSize(i + 1), 1);
+        }
+        UpdateLayersStorage();
+    }
+
+    template<typename T>
+    int Perceptron<T>::GetCheckpointInterval() const
+    {
+        return _checkpointInterval;
+    }
+
+    //
+    // Returns peak size in bytes of the train cache for current topology and checkpoint interval:
+    //      gradients, optimizer state, activations kept for backward propagation and cached derivatives.
+    //
+    template<typename T>
+    std::size_t Perceptron<T>::GetTrainCachePeakSize() const
+    {
+        int weightsCount = _layers.size() - 1;
+        // Activations of the input layer and boundaries are always kept
+        std::size_t elementsCount = GetLayerSize(0);
+        std::size_t segmentMax = 0;
+        std::size_t segment = 0;
+
+        for (int i = 0; i < weightsCount; i++)
+        {
+            std::size_t neuronsCountCurrent = GetLayerSize(i);
+            std::size_t neuronsCountNext = GetLayerSize(i + 1);
+
+            // deltas, deltas of bias and its inertia
+            elementsCount += 3 * neuronsCountNext;
+            // deltas of weights and its inertia
+            elementsCount += 2 * neuronsCountNext * neuronsCountCurrent;
+
+            if (_checkpointInterval > 0 && i % _checkpointInterval == 0)
+                segment = 0;
+            // Derivatives and, inside a segment, activations are kept for one segment at a time
+            segment += neuronsCountNext;
+            if (_checkpointInterval == 0 || (i + 1) % _checkpointInterval == 0 || i + 1 == weightsCount)
+                elementsCount += neuronsCountNext;
+            else
+                segment += neuronsCountNext;
+            segmentMax = std::max(segmentMax, segment);
+        }
+        return (elementsCount + segmentMax) * sizeof(T);
+    }
+
+    //
+    // With @enabled = true BackwardPropagation() also computes the gradient of the loss with respect to the input values:
+    //      (W^1)^T * \delta^1, before weights are adjusted. It is passed to layers feeding the perceptron, such as
+    //      Layers::Convolution, to train them together with the perceptron. Disabled by default to save the product.
+    //
+    template<typename T>
+    void Perceptron<T>::SetInputGradientEnabled(bool enabled)
+    {
+        _inputGradientIsEnabled = enabled;
+        if (!enabled)
+            _inputGradient = Math::Matrix<T>();
+    }
+
+    template<typename T>
+    const Math::Matrix<T>& Perceptron<T>::GetInputGradient() const
+    {
+        if (!_inputGradientIsEnabled)
+            throw std::logic_error("Input gradient is not enabled. Use SetInputGradientEnabled() method.");
+
+        return _inputGradient;
+    }
+
+    //
+    // Gradient accumulation: with @steps > 1 BackwardPropagation() sums gradients of @steps calls and adjusts weights
+    //      once with their average, using learning rate and moment of the last call. It trains like batches of @steps
+    //      samples, while activations are kept for one sample only, and the update of weights and inertia runs
+    //      once per @steps samples. Weights don't change between the accumulated calls.
+    // Param @steps = 1 adjusts weights on every call (default).
+    //
+    template<typename T>
+    void Perceptron<T>::SetGradientAccumulationSteps(int steps)
+    {
+        if (steps < 1)
+            throw std::invalid_argument("Gradient accumulation steps must be positive");
+
+        if (_accumulatedStepsCount > 0)
+            throw std::logic_error("Accumulated gradients are not applied. Use ApplyAccumulatedGradients() method.");
+
+        _gradientAccumulationSteps = steps;
+    }
+
+    template<typename T>
+    int Perceptron<T>::GetGradientAccumulationSteps() const
+    {
+        return _gradientAccumulationSteps;
+    }
+
+    //
+    // Returns the number of BackwardPropagation() calls whose gradients are accumulated but not applied yet.
+    //
+    template<typename T>
+    int Perceptron<T>::GetAccumulatedStepsCount() const
+    {
+        return _accumulatedStepsCount;
+    }
+
+    //
+    // Adjusts weights with the average of accumulated gradients, for example for the last incomplete group of an epoch.
+    //      Does nothing when there are no accumulated gradients.
+    //
+    template<typename T>
+    void Perceptron<T>::ApplyAccumulatedGradients(T learningRate, T moment)
+    {
+        if (_accumulatedStepsCount == 0)
+            return;
+
+        ReleasePackedWeights();
+        T scale = static_cast<T>(1.0) / _accumulatedStepsCount;
+        for (int weightIndex = 0; weightIndex < _weights.size(); weightIndex++)
+        {
+            if (_accumulatedStepsCount > 1)
+            {
+                _deltasWeights[weightIndex] *= scale;
+                _deltasBias[weightIndex] *= scale;
+            }
+            AdjustWeights(weightIndex, learningRate, moment);
+        }
+        _accumulatedStepsCount = 0;
+    }
+
+    //
+    // Returns memory currently allocated by the perceptron. The train cache is counted when it is initialized,
+    //      packed weights when the perceptron is frozen for inference.
+    //
+    template<typename T>
+    MemoryFootprint Perceptron<T>::GetMemoryFootprint() const
+    {
+        MemoryFootprint footprint;
+        auto addMatrices = [&footprint](const std::vector<Math::Matrix<T>>& matrices, std::size_t& component)
+        {
+            for (const Math::Matrix<T>& matrix : matrices)
+            {
+                component += Math::Matrix<T>::GetElementsSize(matrix.GetRows(), matrix.GetCols());
+                footprint.overhead += Math::Matrix<T>::GetOverheadSize(matrix.GetRows(), matrix.GetCols());
+            }
+        };
+
+        addMatrices(_weights, footprint.parameters);
+        addMatrices(_bias, footprint.parameters);
+        addMatrices(_layers, footprint.activations);
+        addMatrices(_segmentLayers, footprint.activations);
+        addMatrices(_derivatives, footprint.activations);
+        addMatrices(_deltas, footprint.gradients);
+        addMatrices(_deltasWeights, footprint.gradients);
+        addMatrices(_deltasBias, footprint.gradients);
+        footprint.gradients += Math::Matrix<T>::GetElementsSize(_inputGradient.GetRows(), _inputGradient.GetCols());
+        footprint.overhead += Math::Matrix<T>::GetOverheadSize(_inputGradient.GetRows(), _inputGradient.GetCols());
+        addMatrices(_deltasWeightsInertia, footprint.optimizerState);
+        addMatrices(_deltasBiasInertia, footprint.optimizerState);
+
+        for (int replica = 0; replica < _packedWeights.size(); replica++)
+        {
+            for (int i = 0; i < _packedWeights[replica].size(); i++)
+            {
+                footprint.packedWeights += sizeof(T) * (_packedWeights[replica][i].capacity() + _packedBias[replica][i].capacity());
+                footprint.overhead += 2 * Memory::GetAllocationOverhead();
+            }
+        }
+        return footprint;
+    }
+
+    //
+    // Predicts memory of a perceptron with @neuronsCountPerLayer before it is allocated.
+    // Param @batchSize is the columns count of layers, derivatives and deltas, as kept by batched training.
+    //      The perceptron itself propagates one sample, GetMemoryFootprint() of it matches the estimate for @batchSize = 1.
+    // Param @withTrainCache includes the cache of InitTrainCache() for @checkpointInterval.
+    //
+    template<typename T>
+    MemoryFootprint Perceptron<T>::EstimateMemoryFootprint(const std::vector<int>& neuronsCountPerLayer, int batchSize, bool withTrainCache, int checkpointInterval)
+    {
+        if (neuronsCountPerLayer.size() < 1)
+            throw std::invalid_argument("Neuron layers count must be more than 1");
+
+        if (batchSize < 1)
+            throw std::invalid_argument("Batch size must be positive");
+
+        if (checkpointInterval < 0)
+            throw std::invalid_argument("Checkpoint interval must be non-negative");
+
+        MemoryFootprint footprint;
+        auto addMatrix = [&footprint](int rows, int cols, std::size_t& component)
+        {
+            component += Math::Matrix<T>::GetElementsSize(rows, cols);
+            footprint.overhead += Math::Matrix<T>::GetOverheadSize(rows, cols);
+        };
+
+        int weightsCount = neuronsCountPerLayer.size() - 1;
+        int derivativesCount = checkpointInterval == 0 || checkpointInterval > weightsCount ? weightsCount : checkpointInterval;
+        for (int i = 0; i < neuronsCountPerLayer.size(); i++)
+        {
+            // With checkpointing layers inside segments share the buffers of the largest segment
+            bool isStored = !withTrainCache || checkpointInterval == 0 || i % checkpointInterval == 0 || i == weightsCount;
+            if (isStored)
+                addMatrix(neuronsCountPerLayer[i], batchSize, footprint.activations);
+            else if (i < checkpointInterval)
+            {
+                int rowsMax = 0;
+                for (int layer = i; layer < weightsCount; layer += checkpointInterval)
+                {
+                    rowsMax = std::max(rowsMax, neuronsCountPerLayer[layer]);
+                }
+                addMatrix(rowsMax, batchSize, footprint.activations);
+            }
+        }
+
+        for (int i = 0; i < weightsCount; i++)
+        {
+            int neuronsCountCurrent = neuronsCountPerLayer[i];
+            int neuronsCountNext = neuronsCountPerLayer[i + 1];
+            addMatrix(neuronsCountNext, neuronsCountCurrent, footprint.parameters);
+            addMatrix(neuronsCountNext, 1, footprint.parameters);
+
+            if (!withTrainCache)
+                continue;
+
+            // With checkpointing the derivatives of the largest segment are kept
+            if (i < derivativesCount)
+            {
+                int rowsMax = 0;
+                for (int layer = i; layer < weightsCount; layer += derivativesCount)
+                {
+                    rowsMax = std::max(rowsMax, neuronsCountPerLayer[layer + 1]);
+                }
+                addMatrix(checkpointInterval == 0 ? neuronsCountNext : rowsMax, batchSize, footprint.activations);
+            }
+            addMatrix(neuronsCountNext, batchSize, footprint.gradients);
+            addMatrix(neuronsCountNext, neuronsCountCurrent, footprint.gradients);
+            addMatrix(neuronsCountNext, 1, footprint.gradients);
+            addMatrix(neuronsCountNext, neuronsCountCurrent, footprint.optimizerState);
+            addMatrix(neuronsCountNext, 1, footprint.optimizerState);
+        }
+        return footprint;
+    }
+
+    template<typename T>
+    std::vector<int> Perceptron<T>::GetNeuronsCountPerLayer() const
+    {
+        std::vector<int> neuronsCountPerLayer;
+        for (int i = 0; i < _layers.size(); i++)
+        {
+            neuronsCountPerLayer.push_back(GetLayerSize(i));
+        }
+        return neuronsCountPerLayer;
+    }
+
+    //
+    // Weights and bias between layers (@layerIndex) and (@layerIndex + 1).
+    //
+    template<typename T>
+    const Math::Matrix<T>& Perceptron<T>::GetWeights(int layerIndex) const
+    {
+        return _weights[layerIndex];
+    }
+
+    template<typename T>
+    const Math::Matrix<T>& Perceptron<T>::GetBias(int layerIndex) const
+    {
+        return _bias[layerIndex];
+    }
+
+    //
+    // Copies weights and bias of the perceptron with the same topology.
+    // A perceptron frozen for inference stays frozen, the copied weights are packed into its existing panels.
+    //
+    template<typename T>
+    void Perceptron<T>::CopyParametersFrom(const Perceptron<T>& other)
+    {
+        // Sizes of weights define the topology, comparing them does not allocate
+        bool isTopologyEqual = other._weights.size() == _weights.size();
+        for (int i = 0; isTopologyEqual && i < _weights.size(); i++)
+        {
+            isTopologyEqual = other._weights[i].GetRows() == _weights[i].GetRows() && other._weights[i].GetCols() == _weights[i].GetCols();
+        }
+        if (!isTopologyEqual)
+            throw std::invalid_argument("Topology of perceptrons not equal");
+
+        _weights = other._weights;
+        _bias = other._bias;
+        if (IsFrozenForInference())
+            FreezeForInference(_packedWeights.size() > 1);
+    }
+
+    //
+    // Copies trainable state to @state. Matrices of @state are reused when they already have right size,
+    //      so taking repeated snapshots to the same state does not allocate memory.
+    //
+    template<typename T>
+    void Perceptron<T>::GetState(PerceptronState<T>& state) const
+    {
+        state.neuronsCountPerLayer = GetNeuronsCountPerLayer();
+        state.weights = _weights;
+        state.bias = _bias;
+
+        if (_cacheIsInitialized)
+        {
+            state.deltasWeightsInertia = _deltasWeightsInertia;
+            state.deltasBiasInertia = _deltasBiasInertia;
+        }
+        else
+        {
+            state.deltasWeightsInertia.clear();
+            state.deltasBiasInertia.clear();
+        }
+    }
+
+    //
+    // Restores trainable state. When @state contains inertia the train cache is initialized,
+    //      so training continues exactly from the saved state.
+    //
+    template<typename T>
+    void Perceptron<T>::SetState(const PerceptronState<T>& state)
+    {
+        if (state.neuronsCountPerLayer != GetNeuronsCountPerLayer())
+            throw std::invalid_argument("Topology of the state not equal topology of the perceptron");
+
+        ReleasePackedWeights();
+        _weights = state.weights;
+        _bias = state.bias;
+
+        if (state.deltasWeightsInertia.empty())
+            return;
+
+        if (!_cacheIsInitialized)
+            InitTrainCache();
+
+        _deltasWeightsInertia = state.deltasWeightsInertia;
+        _deltasBiasInertia = state.deltasBiasInertia;
+    }
+
+    template<typename T>
+    void Perceptron<T>::SaveState(std::ostream& stream) const
+    {
+        PerceptronState<T> state;
+        GetState(state);
+        WriteState(stream, state);
+    }
+
+    template<typename T>
+    void Perceptron<T>::LoadState(std::istream& stream)
+    {
+        PerceptronState<T> state;
+        ReadState(stream, state);
+        SetState(state);
+    }
+
+    //
+    // Binary format of the state:
+    //      "NNPS", format version, size of element, layers count (32-bit integers),
+    //      neurons count per layer, weights and bias matrices,
+    //      inertia flag (8-bit) and inertia matrices of weights and bias if flag is set.
+    // Matrices are written by Math::Matrix<T>::WriteBinary().
+    //
+    template<typename T>
+    void Perceptron<T>::WriteState(std::ostream& stream, const PerceptronState<T>& state)
+    {
+        std::int32_t header[4] = { StateMagic, StateVersion, static_cast<std::int32_t>(sizeof(T)), static_cast<std::int32_t>(state.neuronsCountPerLayer.size()) };
+        stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+        for (int neuronsCount : state.neuronsCountPerLayer)
+        {
+            std::int32_t value = neuronsCount;
+            stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        for (int i = 0; i < state.weights.size(); i++)
+        {
+            state.weights[i].WriteBinary(stream);
+            state.bias[i].WriteBinary(stream);
+        }
+
+        std::uint8_t hasInertia = state.deltasWeightsInertia.empty() ? 0 : 1;
+        stream.write(reinterpret_cast<const char*>(&hasInertia), sizeof(hasInertia));
+        for (int i = 0; i < state.deltasWeightsInertia.size(); i++)
+        {
+            state.deltasWeightsInertia[i].WriteBinary(stream);
+            state.deltasBiasInertia[i].WriteBinary(stream);
+        }
+
+        if (!stream)
+            throw std::runtime_error("Failed to write perceptron state");
+    }
+
+    template<typename T>
+    void Perceptron<T>::ReadState(std::istream& stream, PerceptronState<T>& state)
+    {
+        std::int32_t header[4];
+        stream.read(reinterpret_cast<char*>(header), sizeof(header));
+        if (!stream || header[0] != StateMagic)
+            throw std::runtime_error("Stream does not contain perceptron state");
+        if (header[1] != StateVersion)
+            throw std::runtime_error("Unsupported version of perceptron state");
+        if (header[2] != sizeof(T))
+            throw std::runtime_error("Element type of perceptron state not match");
+        if (header[3] < 1)
+            throw std::runtime_error("Invalid layers count in perceptron state");
+
+        int layersCount = header[3];
+        state.neuronsCountPerLayer.resize(layersCount);
+        for (int i = 0; i < layersCount; i++)
+        {
+            std::int32_t value;
+            stream.read(reinterpret_cast<char*>(&value), sizeof(value));
+            state.neuronsCountPerLayer[i] = value;
+        }
+
+        state.weights.resize(layersCount - 1);
+        state.bias.resize(layersCount - 1);
+        for (int i = 0; i < layersCount - 1; i++)
+        {
+            state.weights[i].ReadBinary(stream);
+            state.bias[i].ReadBinary(stream);
+
+            int neuronsCountCurrent = state.neuronsCountPerLayer[i];
+            int neuronsCountNext = state.neuronsCountPerLayer[i + 1];
+            if (state.weights[i].GetRows() != neuronsCountNext || state.weights[i].GetCols() != neuronsCountCurrent || state.bias[i].GetRows() != neuronsCountNext)
+                throw std::runtime_error("Size of matrix in perceptron state not match topology");
+        }
+
+        std::uint8_t hasInertia = 0;
+        stream.read(reinterpret_cast<char*>(&hasInertia), sizeof(hasInertia));
+        int inertiaCount = hasInertia ? layersCount - 1 : 0;
+        state.deltasWeightsInertia.resize(inertiaCount);
+        state.deltasBiasInertia.resize(inertiaCount);
+        for (int i = 0; i < inertiaCount; i++)
+        {
+            state.deltasWeightsInertia[i].ReadBinary(stream);
+            state.deltasBiasInertia[i].ReadBinary(stream);
+        }
+
+        if (!stream)
+            throw std::runtime_error("Failed to read perceptron state");
+    }
+
+    //
+    // Returns the cached derivative of layer (@layerIndex + 1), with checkpointing its segment is recomputed
+    //      when it is not loaded, so activations of the segment become available too.
+    //
+    template<typename T>
+    Math::Matrix<T>& Perceptron<T>::GetCachedDerivative(int layerIndex)
+    {
+        if (_checkpointInterval == 0)
+            return _derivatives[layerIndex];
+
+        int segmentStart = layerIndex - layerIndex % _checkpointInterval;
+        if (segmentStart != _segmentStart)
+            RecomputeSegment(segmentStart);
+
+        return _derivatives[layerIndex - segmentStart];
+    }
+
+    //
+    // Recomputes activations inside the segment starting at layer @segmentStart and derivatives of its layers
+    //      from the activations of its first layer, in the same order of operations as ForwardPropagationWithCache().
+    //
+    template<typename T>
+    void Perceptron<T>::RecomputeSegment(int segmentStart)
+    {
+        if (_activationFunction == nullptr || _derivativeFunction == nullptr)
+            throw std::logic_error("Derivatives are not cached. Use ForwardPropagationWithCache() method.");
+
+        _NN_TRACE_SCOPE("backward", "RecomputeSegment", segmentStart);
+        int segmentEnd = std::min<int>(segmentStart + _checkpointInterval, _layers.size() - 1);
+        for (int i = segmentStart; i < segmentEnd; i++)
+        {
+            Math::Matrix<T>& derivative = _derivatives[i - segmentStart];
+            if (!IsLayerStored(i + 1))
+            {
+                Math::Matrix<T>& output = GetLayer(i + 1);
+                ResizeMatrix(output, GetLayerSize(i + 1), 1);
+                output
+                    .MultAndStoreThis(_weights[i], GetLayer(i))
+                    .AddCol(_bias[i], 0);
+
+                if (_cacheAfterActivationFunction)
+                {
+                    output.ApplyFunction(_activationFunction);
+                    derivative = output;
+                    derivative.ApplyFunction(_derivativeFunction);
+                }
+                else
+                {
+                    derivative = output;
+                    derivative.ApplyFunction(_derivativeFunction);
+                    output.ApplyFunction(_activationFunction);
+                }
+                continue;
+            }
+
+            // The last layer of the segment is kept, only its derivative is needed
+            if (_cacheAfterActivationFunction)
+            {
+                derivative = _layers[i + 1];
+            }
+            else
+            {
+                ResizeMatrix(derivative, GetLayerSize(i + 1), 1);
+                derivative
+                    .MultAndStoreThis(_weights[i], GetLayer(i))
+                    .AddCol(_bias[i], 0);
+            }
+            derivative.ApplyFunction(_derivativeFunction);
+        }
+        _segmentStart = segmentStart;
+    }
+
+    //
+    // Returns true when activations of @layerIndex are kept in _layers, false for layers inside checkpointed
+    //      segments while training.
+    //
+    template<typename T>
+    bool Perceptron<T>::IsLayerStored(int layerIndex) const
+    {
+        if (!_cacheIsInitialized || _checkpointInterval == 0)
+            return true;
+        return layerIndex % _checkpointInterval == 0 || layerIndex == _layers.size() - 1;
+    }
+
+    template<typename T>
+    Math::Matrix<T>& Perceptron<T>::GetLayer(int layerIndex)
+    {
+        if (IsLayerStored(layerIndex))
+            return _layers[layerIndex];
+        return _segmentLayers[layerIndex % _checkpointInterval - 1];
+    }
+
+    //
+    // Returns neurons count of @layerIndex, which doesn't depend on whether the layer is stored.
+    //
+    template<typename T>
+    int Perceptron<T>::GetLayerSize(int layerIndex) const
+    {
+        if (layerIndex == 0)
+            return _layers[0].GetRows();
+        return _weights[layerIndex - 1].GetRows();
+    }
+
+    //
+    // Releases layers inside checkpointed segments and allocates buffers of one segment instead,
+    //      or restores all layers when checkpointing is disabled or the train cache is cleared.
+    //
+    template<typename T>
+    void Perceptron<T>::UpdateLayersStorage()
+    {
+        _segmentStart = -1;
+        for (int i = 1; i < _layers.size() - 1; i++)
+        {
+            if (IsLayerStored(i))
+                ResizeMatrix(_layers[i], GetLayerSize(i), std::max(_layers[i].GetCols(), 1));
+            else
+                _layers[i] = Math::Matrix<T>();
+        }
+
+        _segmentLayers.clear();
+        if (!_cacheIsInitialized || _checkpointInterval == 0)
+            return;
+
+        _segmentLayers.resize(GetDerivativesCount() - 1);
+        for (int i = 0; i < _segmentLayers.size(); i++)
+        {
+            _segmentLayers[i] = Math::Matrix<T>(GetLayerSize(i + 1), 1, false);
+        }
+    }
+
+    template<typename T>
+    int Perceptron<T>::GetDerivativesCount() const
+    {
+        int weightsCount = _layers.size() - 1;
+        if (_checkpointInterval == 0 || _checkpointInterval > weightsCount)
+            return weightsCount;
+        return _checkpointInterval;
+    }
+
+    //
+    // Reallocates @matrix when its size differs, values are not preserved.
+    //
+    template<typename T>
+    void Perceptron<T>::ResizeMatrix(Math::Matrix<T>& matrix, int rows, int cols)
+    {
+        if (matrix.GetRows() != rows || matrix.GetCols() != cols)
+            matrix = Math::Matrix<T>(rows, cols, false);
     }
 
     template<typename U>
@@ -242,8 +1240,8 @@ namespace NeuralNetwork
 
         for (int layerIndex = 0; layerIndex < perceptron._weights.size(); layerIndex++)
         {
-            std::cout << "w" << layerIndex << std::endl << perceptron._weights[layerIndex];
-            std::cout << "b" << layerIndex << std::endl << perceptron._bias[layerIndex];
+            stream << "w" << layerIndex << std::endl << perceptron._weights[layerIndex];
+            stream << "b" << layerIndex << std::endl << perceptron._bias[layerIndex];
         }
         return stream;
     }
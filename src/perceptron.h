@@ -1,11 +1,72 @@
 #pragma once
 
 #include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 
 #include "math/matrix.h"
+#include "memory/allocator.h"
 
 namespace NeuralNetwork
 {
+    namespace Training
+    {
+        template<typename T>
+        class PipelineTrainer;
+        template<typename T>
+        class HogwildTrainer;
+        template<typename T>
+        class DistributedTrainer;
+    }
+
+    enum class WeightsInitialization
+    {
+        Uniform,
+        Normal,
+        XavierUniform,
+        XavierNormal,
+        HeUniform,
+        HeNormal
+    };
+
+    //
+    // Trainable state of the perceptron: parameters and momentum inertia (empty when train cache is not initialized).
+    //
+    template<typename T>
+    struct PerceptronState
+    {
+        std::vector<int> neuronsCountPerLayer;
+        std::vector<Math::Matrix<T>> weights;
+        std::vector<Math::Matrix<T>> bias;
+        std::vector<Math::Matrix<T>> deltasWeightsInertia;
+        std::vector<Math::Matrix<T>> deltasBiasInertia;
+    };
+
+    //
+    // Memory used by a perceptron in bytes, per component. Overhead is memory allocated besides elements:
+    //      row pointers tables of matrices and allocation headers.
+    //
+    struct MemoryFootprint
+    {
+        // Weights and bias
+        std::size_t parameters = 0;
+        // Values of layers and cached derivatives
+        std::size_t activations = 0;
+        // Deltas of neurons, weights and bias
+        std::size_t gradients = 0;
+        // Momentum inertia
+        std::size_t optimizerState = 0;
+        // Weights and bias packed by FreezeForInference()
+        std::size_t packedWeights = 0;
+        std::size_t overhead = 0;
+
+        std::size_t GetTotal() const
+        {
+            return parameters + activations + gradients + optimizerState + packedWeights + overhead;
+        }
+    };
+
     template<typename T>
     class Perceptron
     {
@@ -24,14 +85,49 @@ namespace NeuralNetwork
 
         bool _cacheIsInitialized;
 
+        // Gradient checkpointing (see SetCheckpointInterval()): hidden layers inside segments are not kept in _layers
+        //      while training, their activations live in _segmentLayers for one segment at a time, the one starting
+        //      at layer _segmentStart whose derivatives are in _derivatives. -1 when no segment is loaded.
+        int _checkpointInterval;
+        int _segmentStart;
+        std::vector<Math::Matrix<T>> _segmentLayers;
+        T(*_activationFunction)(T);
+        T(*_derivativeFunction)(T);
+        bool _cacheAfterActivationFunction;
+
+        // Gradient of the loss with respect to the input layer, computed by BackwardPropagation() when enabled
+        bool _inputGradientIsEnabled;
+        Math::Matrix<T> _inputGradient;
+
+        // BackwardPropagation() calls summed in _deltasWeights and _deltasBias before one adjustment of weights
+        int _gradientAccumulationSteps;
+        int _accumulatedStepsCount;
+
+        // Weights packed by FreezeForInference(): [replica][layer][panel * PackedPanelRows * cols + col * PackedPanelRows + row in panel],
+        //      the last panel of a layer is padded with zeros. There is one replica per NUMA node when replication is enabled.
+        // Empty when the perceptron is not frozen.
+        std::vector<std::vector<std::vector<T, Memory::Allocator<T>>>> _packedWeights;
+        std::vector<std::vector<std::vector<T, Memory::Allocator<T>>>> _packedBias;
+
+        static constexpr int PackedPanelRows = 8;
+        static constexpr int PackedPanelSamples = 4;
+
+        static constexpr std::int32_t StateMagic = 0x53504E4E; // "NNPS"
+        static constexpr std::int32_t StateVersion = 1;
+
     public:
         Perceptron(const std::vector<int>& neuronsCountPerLayer);
 
         void RandomizeWeights(unsigned int seed, T lowerBorder, T upperBorder);
+        void InitializeWeights(WeightsInitialization scheme, unsigned long long seed, T scale = 1);
 
         void SetInputValues(const Math::Matrix<T>& inputValues);
 
         const Math::Matrix<T>& ForwardPropagation(T(*activationFunction)(T));
+        Math::Matrix<T> ForwardPropagationBatch(const Math::Matrix<T>& inputValues, T(*activationFunction)(T)) const;
+
+        void FreezeForInference(bool replicatePerNumaNode = false);
+        bool IsFrozenForInference() const;
 
         const Math::Matrix<T>& ForwardPropagationWithCache(T(*activationFunction)(T), T(*derivativeFunction)(T), bool cacheAfterActivationFunction = false);
         void BackwardPropagation(const Math::Matrix<T>& idealValues, T learningRate, T moment);
@@ -39,7 +135,55 @@ namespace NeuralNetwork
         void InitTrainCache();
         void ClearTrainCache();
 
+        void SetCheckpointInterval(int interval);
+        int GetCheckpointInterval() const;
+        std::size_t GetTrainCachePeakSize() const;
+
+        void SetInputGradientEnabled(bool enabled);
+        const Math::Matrix<T>& GetInputGradient() const;
+
+        void SetGradientAccumulationSteps(int steps);
+        int GetGradientAccumulationSteps() const;
+        int GetAccumulatedStepsCount() const;
+        void ApplyAccumulatedGradients(T learningRate, T moment);
+
+        MemoryFootprint GetMemoryFootprint() const;
+        static MemoryFootprint EstimateMemoryFootprint(const std::vector<int>& neuronsCountPerLayer, int batchSize = 1, bool withTrainCache = true, int checkpointInterval = 0);
+
+        std::vector<int> GetNeuronsCountPerLayer() const;
+        const Math::Matrix<T>& GetWeights(int layerIndex) const;
+        const Math::Matrix<T>& GetBias(int layerIndex) const;
+        void CopyParametersFrom(const Perceptron<T>& other);
+
+        void GetState(PerceptronState<T>& state) const;
+        void SetState(const PerceptronState<T>& state);
+        void SaveState(std::ostream& stream) const;
+        void LoadState(std::istream& stream);
+
+        static void WriteState(std::ostream& stream, const PerceptronState<T>& state);
+        static void ReadState(std::istream& stream, PerceptronState<T>& state);
+
         template<typename U>
         friend std::ostream& operator<<(std::ostream& stream, const Perceptron<U>& perceptron);
+
+        friend class Training::PipelineTrainer<T>;
+        friend class Training::HogwildTrainer<T>;
+        friend class Training::DistributedTrainer<T>;
+
+    private:
+        void AdjustWeights(int layerIndex, T learningRate, T moment);
+        void AccumulateGradients(int layerIndex);
+        void ForwardPropagationPacked(int layerIndex, const Math::Matrix<T>& inputValues, Math::Matrix<T>& outputValues, T(*activationFunction)(T)) const;
+        void ReleasePackedWeights();
+        void FillParameters(const std::function<void(int, Math::Matrix<T>&, int, int, std::uint64_t)>& fill, bool fillBias);
+
+        Math::Matrix<T>& GetCachedDerivative(int layerIndex);
+        void RecomputeSegment(int segmentStart);
+        bool IsLayerStored(int layerIndex) const;
+        Math::Matrix<T>& GetLayer(int layerIndex);
+        int GetLayerSize(int layerIndex) const;
+        void UpdateLayersStorage();
+        int GetDerivativesCount() const;
+        static void ResizeMatrix(Math::Matrix<T>& matrix, int rows, int cols);
     };
 }
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "perf_counters.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _NN_PERF_EVENTS
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace NeuralNetwork::Profiling
+{
+    namespace
+    {
+        const char* const PerfCounterNames[PerfCountersCount] =
+        {
+            "cycles",
+            "instructions",
+            "l1dMisses",
+            "llcMisses",
+            "branchMisses",
+            "fpOperations",
+            "pageFaults"
+        };
+
+        // Raw config of the floating point operations event
+        const char FloatingPointEventVariable[] = "NN_PERF_FP_EVENT";
+
+#ifdef _NN_PERF_EVENTS
+        //
+        // Returns false when @counter is not configured on this machine.
+        //
+        bool GetEventAttributes(PerfCounter counter, perf_event_attr& attributes)
+        {
+            std::memset(&attributes, 0, sizeof(attributes));
+            attributes.size = sizeof(attributes);
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            switch (counter)
+            {
+            case PerfCounter::Cycles:
+                attributes.type = PERF_TYPE_HARDWARE;
+                attributes.config = PERF_COUNT_HW_CPU_CYCLES;
+                return true;
+            case PerfCounter::Instructions:
+                attributes.type = PERF_TYPE_HARDWARE;
+                attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+                return true;
+            case PerfCounter::L1DataMisses:
+                attributes.type = PERF_TYPE_HW_CACHE;
+                attributes.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                return true;
+            case PerfCounter::LastLevelCacheMisses:
+                attributes.type = PERF_TYPE_HARDWARE;
+                attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+                return true;
+            case PerfCounter::BranchMisses:
+                attributes.type = PERF_TYPE_HARDWARE;
+                attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+                return true;
+            case PerfCounter::FloatingPointOperations:
+            {
+                const char* config = std::getenv(FloatingPointEventVariable);
+                if (config == nullptr || *config == '\0')
+                    return false;
+
+                attributes.type = PERF_TYPE_RAW;
+                attributes.config = std::strtoull(config, nullptr, 16);
+                return true;
+            }
+            case PerfCounter::PageFaults:
+                attributes.type = PERF_TYPE_SOFTWARE;
+                attributes.config = PERF_COUNT_SW_PAGE_FAULTS;
+                return true;
+            default:
+                return false;
+            }
+        }
+#endif
+    }
+
+    const char* GetPerfCounterName(PerfCounter counter)
+    {
+        return PerfCounterNames[static_cast<int>(counter)];
+    }
+
+    bool PerfCounterValues::IsAvailable(PerfCounter counter) const
+    {
+        return isAvailable[static_cast<int>(counter)];
+    }
+
+    std::uint64_t PerfCounterValues::Get(PerfCounter counter) const
+    {
+        return values[static_cast<int>(counter)];
+    }
+
+    //
+    // Returns instructions per cycle, 0 when cycles or instructions are not available.
+    //
+    double PerfCounterValues::GetInstructionsPerCycle() const
+    {
+        if (!IsAvailable(PerfCounter::Cycles) || !IsAvailable(PerfCounter::Instructions) || Get(PerfCounter::Cycles) == 0)
+            return 0.0;
+
+        return static_cast<double>(Get(PerfCounter::Instructions)) / Get(PerfCounter::Cycles);
+    }
+
+    PerfCounterValues PerfCounterValues::operator-(const PerfCounterValues& other) const
+    {
+        PerfCounterValues result;
+        for (int i = 0; i < PerfCountersCount; i++)
+        {
+            result.isAvailable[i] = isAvailable[i] && other.isAvailable[i];
+            // Scaled values of a multiplexed group may decrease slightly
+            result.values[i] = values[i] > other.values[i] ? values[i] - other.values[i] : 0;
+        }
+        return result;
+    }
+
+    //
+    // Sums values of available counters, a counter stays available only when it is available in both.
+    //
+    PerfCounterValues& PerfCounterValues::operator+=(const PerfCounterValues& other)
+    {
+        for (int i = 0; i < PerfCountersCount; i++)
+        {
+            isAvailable[i] = isAvailable[i] && other.isAvailable[i];
+            values[i] += other.values[i];
+        }
+        return *this;
+    }
+
+    PerfCounters::PerfCounters() :
+        _groupFd(-1),
+        _groupSize(0)
+    {
+        _fds.fill(-1);
+        _groupPositions.fill(-1);
+
+#ifdef _NN_PERF_EVENTS
+        // Hardware counters go first: a hardware event can't join a group led by a software one
+        for (int i = 0; i < PerfCountersCount; i++)
+        {
+            perf_event_attr attributes;
+            if (!GetEventAttributes(static_cast<PerfCounter>(i), attributes))
+                continue;
+
+            int fd = static_cast<int>(syscall(__NR_perf_event_open, &attributes, 0, -1, _groupFd, PERF_FLAG_FD_CLOEXEC));
+            if (fd < 0)
+                continue;
+
+            if (_groupFd < 0)
+                _groupFd = fd;
+            _fds[i] = fd;
+            _groupPositions[i] = _groupSize++;
+        }
+#endif
+    }
+
+    PerfCounters::~PerfCounters()
+    {
+#ifdef _NN_PERF_EVENTS
+        // Members are closed before the leader
+        for (int i = PerfCountersCount - 1; i >= 0; i--)
+        {
+            if (_fds[i] >= 0 && _fds[i] != _groupFd)
+                close(_fds[i]);
+        }
+        if (_groupFd >= 0)
+            close(_groupFd);
+#endif
+    }
+
+    bool PerfCounters::IsAvailable(PerfCounter counter) const
+    {
+        return _groupPositions[static_cast<int>(counter)] >= 0;
+    }
+
+    bool PerfCounters::IsAnyAvailable() const
+    {
+        return _groupSize > 0;
+    }
+
+    //
+    // Returns values counted since construction.
+    //
+    PerfCounterValues PerfCounters::Read() const
+    {
+        PerfCounterValues result;
+#ifdef _NN_PERF_EVENTS
+        if (_groupFd < 0)
+            return result;
+
+        // Layout of PERF_FORMAT_GROUP: count, time enabled, time running, values
+        std::uint64_t buffer[3 + PerfCountersCount];
+        ssize_t size = read(_groupFd, buffer, sizeof(std::uint64_t) * (3 + _groupSize));
+        if (size < static_cast<ssize_t>(sizeof(std::uint64_t) * (3 + _groupSize)) || buffer[0] != static_cast<std::uint64_t>(_groupSize))
+            return result;
+
+        std::uint64_t enabledTime = buffer[1];
+        std::uint64_t runningTime = buffer[2];
+        // Counters of a group which was never scheduled are unknown rather than zero
+        if (runningTime == 0)
+            return result;
+
+        double scale = static_cast<double>(enabledTime) / runningTime;
+        for (int i = 0; i < PerfCountersCount; i++)
+        {
+            int position = _groupPositions[i];
+            if (position < 0)
+                continue;
+
+            result.isAvailable[i] = true;
+            result.values[i] = runningTime < enabledTime ? static_cast<std::uint64_t>(buffer[3 + position] * scale) : buffer[3 + position];
+        }
+#endif
+        return result;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#if defined(__linux__)
+#define _NN_PERF_EVENTS
+#endif
+
+namespace NeuralNetwork::Profiling
+{
+    enum class PerfCounter
+    {
+        Cycles,
+        Instructions,
+        L1DataMisses,
+        LastLevelCacheMisses,
+        BranchMisses,
+        // Raw event given by NN_PERF_FP_EVENT environment variable, see PerfCounters
+        FloatingPointOperations,
+        PageFaults
+    };
+
+    constexpr int PerfCountersCount = 7;
+
+    const char* GetPerfCounterName(PerfCounter counter);
+
+    //
+    // Values of hardware counters, counters which could not be opened are not available.
+    //
+    struct PerfCounterValues
+    {
+        std::array<std::uint64_t, PerfCountersCount> values{};
+        std::array<bool, PerfCountersCount> isAvailable{};
+
+        bool IsAvailable(PerfCounter counter) const;
+        std::uint64_t Get(PerfCounter counter) const;
+        double GetInstructionsPerCycle() const;
+
+        PerfCounterValues operator-(const PerfCounterValues& other) const;
+        PerfCounterValues& operator+=(const PerfCounterValues& other);
+    };
+
+    //
+    // Linux performance counters (perf_event_open) of the calling thread, user mode only. Counting starts
+    //      on construction, the difference of two Read() results gives counters of the code between them.
+    // Counters are opened as one group and read by one system call. When the PMU has fewer registers than
+    //      counters, the kernel multiplexes the group and values are scaled by the time it was counting.
+    // Counters which are not supported (virtual machines without PMU, perf_event_paranoid restrictions)
+    //      are silently unavailable. Floating point operations are model specific, they are counted when
+    //      NN_PERF_FP_EVENT holds a raw event config in hex, for example FP_ARITH_INST_RETIRED of Intel CPUs.
+    //
+    class PerfCounters
+    {
+    private:
+        int _groupFd;
+        std::array<int, PerfCountersCount> _fds;
+        // Position of every counter in the values read from the group, -1 for unavailable counters
+        std::array<int, PerfCountersCount> _groupPositions;
+        int _groupSize;
+
+    public:
+        PerfCounters();
+        ~PerfCounters();
+
+        PerfCounters(const PerfCounters& other) = delete;
+        PerfCounters& operator=(const PerfCounters& other) = delete;
+
+        bool IsAvailable(PerfCounter counter) const;
+        bool IsAnyAvailable() const;
+
+        PerfCounterValues Read() const;
+    };
+}
\ No newline at end of file
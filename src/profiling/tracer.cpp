@@ -0,0 +1,332 @@
+#include "tracer.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+namespace NeuralNetwork::Profiling
+{
+    namespace
+    {
+        struct TraceEvent
+        {
+            const char* category;
+            const char* name;
+            int index;
+            std::int64_t start;
+            std::int64_t end;
+            // Index in ThreadBuffer::counters, -1 for spans without counters
+            int countersIndex;
+        };
+
+        struct ThreadBuffer
+        {
+            std::mutex mutex;
+            std::vector<TraceEvent> events;
+            std::vector<PerfCounterValues> counters;
+            std::string name;
+            int threadId;
+        };
+
+        std::atomic<bool> isEnabled(false);
+        std::atomic<bool> isPerfCountersEnabled(false);
+        std::atomic<std::size_t> eventsCount(0);
+        std::atomic<std::size_t> droppedEventsCount(0);
+        std::atomic<std::size_t> maxEventsCount(0);
+
+        // Buffers stay registered after their threads exit, so spans of finished threads are written too
+        std::mutex buffersMutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        thread_local std::shared_ptr<ThreadBuffer> threadBuffer;
+        // Counters count only the thread which opened them
+        thread_local std::unique_ptr<PerfCounters> threadPerfCounters;
+
+        const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+        std::int64_t GetTimestamp()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+        }
+
+        ThreadBuffer& GetThreadBuffer()
+        {
+            if (threadBuffer == nullptr)
+            {
+                threadBuffer = std::make_shared<ThreadBuffer>();
+                std::lock_guard<std::mutex> lock(buffersMutex);
+                threadBuffer->threadId = buffers.size() + 1;
+                buffers.push_back(threadBuffer);
+            }
+            return *threadBuffer;
+        }
+
+        PerfCounters* GetThreadPerfCounters()
+        {
+            if (threadPerfCounters == nullptr)
+                threadPerfCounters = std::make_unique<PerfCounters>();
+            return threadPerfCounters.get();
+        }
+
+        void WriteEscaped(std::ostream& stream, const std::string& text)
+        {
+            for (char symbol : text)
+            {
+                if (symbol == '"' || symbol == '\\')
+                    stream << '\\' << symbol;
+                else if (static_cast<unsigned char>(symbol) >= 0x20)
+                    stream << symbol;
+            }
+        }
+
+        //
+        // Writes index and counters of @event, nothing when it has neither.
+        //
+        void WriteArguments(std::ostream& stream, const TraceEvent& event, const ThreadBuffer& buffer)
+        {
+            if (event.index < 0 && event.countersIndex < 0)
+                return;
+
+            const char* separator = "";
+            stream << ",\"args\":{";
+            if (event.index >= 0)
+            {
+                stream << "\"index\":" << event.index;
+                separator = ",";
+            }
+
+            if (event.countersIndex >= 0)
+            {
+                const PerfCounterValues& counters = buffer.counters[event.countersIndex];
+                for (int i = 0; i < PerfCountersCount; i++)
+                {
+                    PerfCounter counter = static_cast<PerfCounter>(i);
+                    if (!counters.IsAvailable(counter))
+                        continue;
+
+                    stream << separator << "\"" << GetPerfCounterName(counter) << "\":" << counters.Get(counter);
+                    separator = ",";
+                }
+
+                if (counters.IsAvailable(PerfCounter::Cycles) && counters.IsAvailable(PerfCounter::Instructions))
+                    stream << separator << "\"ipc\":" << counters.GetInstructionsPerCycle();
+            }
+            stream << "}";
+        }
+
+        // Chrome trace timestamps are in microseconds
+        void WriteMicroseconds(std::ostream& stream, std::int64_t nanoseconds)
+        {
+            stream << nanoseconds / 1000 << '.';
+            std::int64_t fraction = nanoseconds % 1000;
+            stream << fraction / 100 << fraction / 10 % 10 << fraction % 10;
+        }
+    }
+
+    //
+    // Starts recording. At most @eventsLimit spans are kept, later ones are counted as dropped.
+    // Param @withPerfCounters records hardware counters of every span (see PerfCounters), they are written
+    //      as arguments of spans and summed by GetTraceSummary(). Reading counters costs a system call
+    //      at both ends of a span, so it is meant for profiling runs.
+    //
+    void StartTracing(std::size_t eventsLimit, bool withPerfCounters)
+    {
+        maxEventsCount = eventsLimit;
+        isPerfCountersEnabled = withPerfCounters;
+        isEnabled = true;
+    }
+
+    void StopTracing()
+    {
+        isEnabled = false;
+    }
+
+    bool IsTracingEnabled()
+    {
+        return isEnabled.load(std::memory_order_relaxed);
+    }
+
+    void ClearTrace()
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (const std::shared_ptr<ThreadBuffer>& buffer : buffers)
+        {
+            std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+            buffer->events.clear();
+            buffer->counters.clear();
+        }
+        eventsCount = 0;
+        droppedEventsCount = 0;
+    }
+
+    std::size_t GetTraceEventsCount()
+    {
+        return eventsCount;
+    }
+
+    std::size_t GetTraceDroppedEventsCount()
+    {
+        return droppedEventsCount;
+    }
+
+    //
+    // Sets the name of the current thread shown in the timeline.
+    //
+    void SetTraceThreadName(const std::string& name)
+    {
+        ThreadBuffer& buffer = GetThreadBuffer();
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        buffer.name = name;
+    }
+
+    //
+    // Writes spans as complete events ("ph": "X") and names of threads as metadata events.
+    // Spans may be written while other threads record, those recorded during writing may be missed.
+    //
+    void WriteChromeTrace(std::ostream& stream)
+    {
+        std::vector<std::shared_ptr<ThreadBuffer>> buffersCopy;
+        {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            buffersCopy = buffers;
+        }
+
+        stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool isFirst = true;
+        for (const std::shared_ptr<ThreadBuffer>& buffer : buffersCopy)
+        {
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+            if (!buffer->name.empty())
+            {
+                stream << (isFirst ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId << ",\"args\":{\"name\":\"";
+                WriteEscaped(stream, buffer->name);
+                stream << "\"}}";
+                isFirst = false;
+            }
+
+            for (const TraceEvent& event : buffer->events)
+            {
+                stream << (isFirst ? "" : ",") << "\n{\"name\":\"";
+                WriteEscaped(stream, event.name);
+                stream << "\",\"cat\":\"";
+                WriteEscaped(stream, event.category);
+                stream << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId << ",\"ts\":";
+                WriteMicroseconds(stream, event.start);
+                stream << ",\"dur\":";
+                WriteMicroseconds(stream, event.end - event.start);
+                WriteArguments(stream, event, *buffer);
+                stream << "}";
+                isFirst = false;
+            }
+        }
+        stream << "\n],\"otherData\":{\"droppedEvents\":" << droppedEventsCount.load() << "}}\n";
+
+        if (!stream)
+            throw std::runtime_error("Failed to write trace");
+    }
+
+    void SaveChromeTrace(const std::string& path)
+    {
+        std::ofstream file(path);
+        if (!file)
+            throw std::runtime_error("Failed to open file " + path);
+
+        WriteChromeTrace(file);
+    }
+
+    //
+    // Returns spans aggregated by category, name and index, sorted by them.
+    //
+    std::vector<TraceSpanSummary> GetTraceSummary()
+    {
+        std::vector<std::shared_ptr<ThreadBuffer>> buffersCopy;
+        {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            buffersCopy = buffers;
+        }
+
+        std::map<std::tuple<std::string, std::string, int>, TraceSpanSummary> summaries;
+        for (const std::shared_ptr<ThreadBuffer>& buffer : buffersCopy)
+        {
+            std::lock_guard<std::mutex> lock(buffer->mutex);
+            for (const TraceEvent& event : buffer->events)
+            {
+                PerfCounterValues counters;
+                if (event.countersIndex >= 0)
+                    counters = buffer->counters[event.countersIndex];
+
+                auto key = std::make_tuple(std::string(event.category), std::string(event.name), event.index);
+                auto found = summaries.find(key);
+                if (found == summaries.end())
+                {
+                    summaries.emplace(key, TraceSpanSummary{ event.category, event.name, event.index, 1, event.end - event.start, counters });
+                    continue;
+                }
+
+                TraceSpanSummary& summary = found->second;
+                summary.count++;
+                summary.totalNanoseconds += event.end - event.start;
+                summary.counters += counters;
+            }
+        }
+
+        std::vector<TraceSpanSummary> result;
+        for (auto& [key, summary] : summaries)
+        {
+            result.push_back(std::move(summary));
+        }
+        return result;
+    }
+
+    TraceScope::TraceScope(const char* category, const char* name, int index) :
+        _category(category),
+        _name(name),
+        _index(index),
+        _start(-1),
+        _perfCounters(nullptr)
+    {
+        if (!IsTracingEnabled())
+            return;
+
+        if (isPerfCountersEnabled.load(std::memory_order_relaxed))
+        {
+            _perfCounters = GetThreadPerfCounters();
+            _startCounters = _perfCounters->Read();
+        }
+        _start = GetTimestamp();
+    }
+
+    TraceScope::~TraceScope()
+    {
+        // Spans started before StopTracing() are completed
+        if (_start < 0)
+            return;
+
+        std::int64_t end = GetTimestamp();
+        PerfCounterValues counters;
+        if (_perfCounters != nullptr)
+            counters = _perfCounters->Read() - _startCounters;
+
+        if (eventsCount.fetch_add(1, std::memory_order_relaxed) >= maxEventsCount.load(std::memory_order_relaxed))
+        {
+            eventsCount.fetch_sub(1, std::memory_order_relaxed);
+            droppedEventsCount.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        ThreadBuffer& buffer = GetThreadBuffer();
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        int countersIndex = -1;
+        if (_perfCounters != nullptr)
+        {
+            countersIndex = buffer.counters.size();
+            buffer.counters.push_back(counters);
+        }
+        buffer.events.push_back({ _category, _name, _index, _start, end, countersIndex });
+    }
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "profiling/perf_counters.h"
+
+namespace NeuralNetwork::Profiling
+{
+    //
+    // Timeline of spans of work in Chrome trace event format, it is opened by chrome://tracing and Perfetto UI.
+    // Spans are recorded by TraceScope objects, the library creates them through _NN_TRACE_SCOPE() which compiles
+    //      to nothing unless the library is built with ENABLE_TRACING. Nothing is recorded until StartTracing().
+    // Every thread appends spans to its own buffer, so threads don't contend while recording.
+    //
+    void StartTracing(std::size_t eventsLimit = 1 << 22, bool withPerfCounters = false);
+    void StopTracing();
+    bool IsTracingEnabled();
+    void ClearTrace();
+
+    std::size_t GetTraceEventsCount();
+    std::size_t GetTraceDroppedEventsCount();
+
+    void SetTraceThreadName(const std::string& name);
+
+    void WriteChromeTrace(std::ostream& stream);
+    void SaveChromeTrace(const std::string& path);
+
+    //
+    // Spans with the same category, name and index aggregated over all threads.
+    //
+    struct TraceSpanSummary
+    {
+        std::string category;
+        std::string name;
+        int index;
+        std::size_t count;
+        std::int64_t totalNanoseconds;
+        // Sums of counters, available when all spans were recorded with counters
+        PerfCounterValues counters;
+    };
+
+    std::vector<TraceSpanSummary> GetTraceSummary();
+
+    //
+    // Records a span from its creation to its destruction.
+    // Params @category and @name must be string literals (only pointers are stored), @index is an optional
+    //      argument of the span like a layer index, negative values are not written.
+    //
+    class TraceScope
+    {
+    private:
+        const char* _category;
+        const char* _name;
+        int _index;
+        std::int64_t _start;
+        // Counters of the thread at the start of the span, read only when tracing with counters
+        PerfCounters* _perfCounters;
+        PerfCounterValues _startCounters;
+
+    public:
+        TraceScope(const char* category, const char* name, int index = -1);
+        ~TraceScope();
+
+        TraceScope(const TraceScope& other) = delete;
+        TraceScope& operator=(const TraceScope& other) = delete;
+    };
+}
+
+#define _NN_TRACE_CONCAT_IMPL(a, b) a##b
+#define _NN_TRACE_CONCAT(a, b) _NN_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef _NN_TRACING
+#define _NN_TRACE_SCOPE(category, name, index) \
+    NeuralNetwork::Profiling::TraceScope _NN_TRACE_CONCAT(_traceScope, __LINE__)(category, name, index)
+#define _NN_TRACE_THREAD_NAME(name) NeuralNetwork::Profiling::SetTraceThreadName(name)
+#else
+#define _NN_TRACE_SCOPE(category, name, index)
+#define _NN_TRACE_THREAD_NAME(name)
+#endif
\ No newline at end of file
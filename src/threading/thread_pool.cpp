@@ -0,0 +1,297 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include "memory/allocator.h"
+#include "profiling/tracer.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace NeuralNetwork::Threading
+{
+    namespace
+    {
+        // Pool and worker index of the current thread, used to submit tasks of a worker to its own queue
+        thread_local const ThreadPool* currentPool = nullptr;
+        thread_local int currentWorkerIndex = -1;
+    }
+
+    ThreadPool::ThreadPool(int threadsCount) : _pendingTasksCount(0), _stop(false)
+    {
+        if (threadsCount < 0)
+            throw std::invalid_argument("Threads count must be non-negative");
+
+        for (int i = 0; i <= threadsCount; i++)
+        {
+            _queues.push_back(std::make_unique<TaskQueue>());
+        }
+
+        _threadsNumaNodes.assign(threadsCount, -1);
+        for (int i = 0; i < threadsCount; i++)
+        {
+            _threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_sleepMutex);
+            _stop = true;
+        }
+        _condition.notify_all();
+
+        for (std::thread& thread : _threads)
+        {
+            thread.join();
+        }
+    }
+
+    int ThreadPool::GetThreadsCount() const
+    {
+        // Queues are created before workers start, so workers may call it while the constructor runs
+        return static_cast<int>(_queues.size()) - 1;
+    }
+
+    //
+    // Pins workers to CPUs filling NUMA nodes one by one, so neighbouring workers share a node.
+    // Returns false when pinning is not supported or failed for any worker.
+    //
+    bool ThreadPool::PinThreads()
+    {
+#ifdef __linux__
+        std::vector<int> cpus;
+        std::vector<int> cpusNodes;
+        for (int node = 0; node < Memory::GetNumaNodesCount(); node++)
+        {
+            for (int cpu : Memory::GetCpusOfNumaNode(node))
+            {
+                cpus.push_back(cpu);
+                cpusNodes.push_back(node);
+            }
+        }
+        if (cpus.empty())
+            return false;
+
+        bool isPinned = true;
+        for (int i = 0; i < _threads.size(); i++)
+        {
+            int cpuIndex = i % cpus.size();
+            cpu_set_t cpuSet;
+            CPU_ZERO(&cpuSet);
+            CPU_SET(cpus[cpuIndex], &cpuSet);
+            if (pthread_setaffinity_np(_threads[i].native_handle(), sizeof(cpuSet), &cpuSet) == 0)
+                _threadsNumaNodes[i] = cpusNodes[cpuIndex];
+            else
+                isPinned = false;
+        }
+        return isPinned;
+#else
+        return false;
+#endif
+    }
+
+    int ThreadPool::GetThreadNumaNode(int threadIndex) const
+    {
+        return _threadsNumaNodes.at(threadIndex);
+    }
+
+    void ThreadPool::Submit(std::function<void()> task)
+    {
+        TaskQueue& queue = *_queues[GetCurrentQueueIndex()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+
+        // Incremented under the sleep mutex, so a worker checking the counter before waiting can't miss the notification
+        {
+            std::lock_guard<std::mutex> lock(_sleepMutex);
+            _pendingTasksCount++;
+        }
+        _condition.notify_one();
+    }
+
+    //
+    // Calls @body for chunks [from, to) of range [@begin, @end) of at least @grainSize elements.
+    // The calling thread executes chunks too, so it is safe to call from a task of the pool.
+    // Chunks are claimed from a counter of this call: the caller runs only chunks of its own range and never
+    //      picks up other tasks of the pool while it waits, so a kernel can't run a long job submitted by others.
+    // An exception thrown by @body is rethrown on the calling thread after all chunks finished,
+    //      when several chunks throw only the first exception is kept.
+    //
+    void ThreadPool::ParallelFor(int begin, int end, int grainSize, const std::function<void(int, int)>& body)
+    {
+        if (begin >= end)
+            return;
+
+        int count = end - begin;
+        int chunksCount = std::min<int>(GetThreadsCount() + 1, (count + grainSize - 1) / std::max(grainSize, 1));
+        chunksCount = std::max(chunksCount, 1);
+        if (chunksCount == 1)
+        {
+            body(begin, end);
+            return;
+        }
+
+        // Helpers may start after the call returned, when all chunks were claimed by others,
+        //      so the state they touch before claiming a chunk is shared with them
+        struct ParallelForState
+        {
+            const std::function<void(int, int)>* body;
+            int begin;
+            int count;
+            int chunksCount;
+            std::atomic<int> nextChunk;
+            std::atomic<int> chunksLeft;
+            std::mutex errorMutex;
+            std::exception_ptr error;
+        };
+
+        auto state = std::make_shared<ParallelForState>();
+        state->body = &body;
+        state->begin = begin;
+        state->count = count;
+        state->chunksCount = chunksCount;
+        state->nextChunk = 0;
+        state->chunksLeft = chunksCount;
+
+        auto runChunks = [](ParallelForState& state)
+        {
+            int chunk;
+            while ((chunk = state.nextChunk++) < state.chunksCount)
+            {
+                _NN_TRACE_SCOPE("pool", "ParallelForChunk", chunk);
+                try
+                {
+                    (*state.body)(static_cast<int>(state.begin + static_cast<long long>(state.count) * chunk / state.chunksCount),
+                        static_cast<int>(state.begin + static_cast<long long>(state.count) * (chunk + 1) / state.chunksCount));
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(state.errorMutex);
+                    if (!state.error)
+                        state.error = std::current_exception();
+                }
+                state.chunksLeft--;
+            }
+        };
+
+        for (int helper = 1; helper < chunksCount; helper++)
+        {
+            Submit([state, runChunks]()
+                {
+                    runChunks(*state);
+                });
+        }
+
+        runChunks(*state);
+
+        // Chunks claimed by helpers reference locals of this call, so it waits for them even when a chunk failed
+        {
+            // Time the caller waits for other chunks shows load imbalance
+            _NN_TRACE_SCOPE("pool", "ParallelForWait", -1);
+            while (state->chunksLeft > 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        // Moved out, so the exception is released by the caller and not by the helper destroying the state last
+        std::exception_ptr error;
+        {
+            std::lock_guard<std::mutex> lock(state->errorMutex);
+            error = std::move(state->error);
+        }
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    //
+    // Shared pool with one thread less than hardware threads, the calling thread is the last one.
+    //      At least one thread is started, so tasks submitted to the pool always make progress.
+    //
+    ThreadPool& ThreadPool::GetDefault()
+    {
+        static ThreadPool pool(std::max<int>(static_cast<int>(std::thread::hardware_concurrency()) - 1, 1));
+        return pool;
+    }
+
+    void ThreadPool::WorkerLoop(int workerIndex)
+    {
+        currentPool = this;
+        currentWorkerIndex = workerIndex;
+        _NN_TRACE_THREAD_NAME("Pool worker " + std::to_string(workerIndex));
+
+        while (true)
+        {
+            std::function<void()> task;
+            if (TakeTask(workerIndex, task))
+            {
+                _NN_TRACE_SCOPE("pool", "Task", -1);
+                task();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(_sleepMutex);
+            _condition.wait(lock, [this]() { return _stop || _pendingTasksCount > 0; });
+
+            if (_stop && _pendingTasksCount <= 0)
+                return;
+        }
+    }
+
+    //
+    // Takes the newest task of queue @queueIndex, otherwise the oldest task of the shared queue,
+    //      otherwise steals the oldest task of other workers starting from the next one.
+    //
+    bool ThreadPool::TakeTask(int queueIndex, std::function<void()>& task)
+    {
+        int workersCount = static_cast<int>(_queues.size()) - 1;
+        if (queueIndex < workersCount && PopTask(*_queues[queueIndex], true, task))
+            return true;
+
+        if (PopTask(*_queues[workersCount], false, task))
+            return true;
+
+        for (int i = 1; i <= workersCount; i++)
+        {
+            int victimIndex = (queueIndex + i) % workersCount;
+            if (victimIndex != queueIndex && PopTask(*_queues[victimIndex], false, task))
+                return true;
+        }
+        return false;
+    }
+
+    bool ThreadPool::PopTask(TaskQueue& queue, bool newest, std::function<void()>& task)
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            return false;
+
+        if (newest)
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        else
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        _pendingTasksCount--;
+        return true;
+    }
+
+    int ThreadPool::GetCurrentQueueIndex() const
+    {
+        return currentPool == this ? currentWorkerIndex : static_cast<int>(_queues.size()) - 1;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+
+namespace NeuralNetwork::Threading
+{
+    //
+    // Work-stealing thread pool. Every worker has its own queue: tasks submitted from a worker go to
+    //      its queue and are taken by the worker in LIFO order, idle workers steal the oldest tasks
+    //      from the queues of other workers. Tasks submitted from other threads go to a shared queue.
+    //
+    class ThreadPool
+    {
+    private:
+        struct TaskQueue
+        {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::thread> _threads;
+        // Queue of worker (i) has index (i), the last queue is for tasks submitted from other threads
+        std::vector<std::unique_ptr<TaskQueue>> _queues;
+        std::atomic<int> _pendingTasksCount;
+        // NUMA node of every worker after PinThreads(), -1 when the worker is not pinned
+        std::vector<int> _threadsNumaNodes;
+
+        std::mutex _sleepMutex;
+        std::condition_variable _condition;
+        bool _stop;
+
+    public:
+        explicit ThreadPool(int threadsCount);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool& other) = delete;
+        ThreadPool& operator=(const ThreadPool& other) = delete;
+
+        int GetThreadsCount() const;
+
+        bool PinThreads();
+        int GetThreadNumaNode(int threadIndex) const;
+
+        void Submit(std::function<void()> task);
+        void ParallelFor(int begin, int end, int grainSize, const std::function<void(int, int)>& body);
+
+        static ThreadPool& GetDefault();
+
+    private:
+        void WorkerLoop(int workerIndex);
+        bool TakeTask(int queueIndex, std::function<void()>& task);
+        bool PopTask(TaskQueue& queue, bool newest, std::function<void()>& task);
+        int GetCurrentQueueIndex() const;
+    };
+}
\ No newline at end of file
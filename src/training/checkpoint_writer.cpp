@@ -0,0 +1,182 @@
+#include "checkpoint_writer.h"
+
+#include <fstream>
+#include <filesystem>
+#include <cstdint>
+#include <stdexcept>
+
+namespace NeuralNetwork::Training
+{
+    template<typename T>
+    CheckpointWriter<T>::CheckpointWriter(const std::string& path) :
+        _path(path),
+        _snapshotSteps{ 0, 0 },
+        _writingIndex(-1),
+        _pendingIndex(-1),
+        _writtenStep(-1),
+        _stop(false)
+    {
+        _thread = std::thread(&CheckpointWriter<T>::WriterLoop, this);
+    }
+
+    //
+    // Pending snapshot is written before the writer thread stops.
+    //
+    template<typename T>
+    CheckpointWriter<T>::~CheckpointWriter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _condition.notify_all();
+        _thread.join();
+    }
+
+    //
+    // Takes a snapshot of the perceptron state for training step @step and queues it for writing.
+    // Rethrows the error of the previous write if it failed.
+    //
+    template<typename T>
+    void CheckpointWriter<T>::Save(const Perceptron<T>& perceptron, long long step)
+    {
+        int snapshotIndex;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_error)
+            {
+                std::exception_ptr error = _error;
+                _error = nullptr;
+                std::rethrow_exception(error);
+            }
+
+            // The buffer not used by the writer, pending snapshot in it is replaced
+            snapshotIndex = _writingIndex == 0 ? 1 : 0;
+            if (_pendingIndex == snapshotIndex)
+                _pendingIndex = -1;
+        }
+
+        perceptron.GetState(_snapshots[snapshotIndex]);
+        _snapshotSteps[snapshotIndex] = step;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pendingIndex = snapshotIndex;
+        }
+        _condition.notify_all();
+    }
+
+    //
+    // Waits until all queued snapshots are written.
+    //
+    template<typename T>
+    void CheckpointWriter<T>::Wait()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _condition.wait(lock, [this]() { return _pendingIndex == -1 && _writingIndex == -1; });
+
+        if (_error)
+        {
+            std::exception_ptr error = _error;
+            _error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    //
+    // Returns step of the last checkpoint written to disk, or -1 if nothing is written yet.
+    //
+    template<typename T>
+    long long CheckpointWriter<T>::GetWrittenStep()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _writtenStep;
+    }
+
+    //
+    // Restores the perceptron from checkpoint file and returns the step of the checkpoint.
+    //
+    template<typename T>
+    long long CheckpointWriter<T>::Load(const std::string& path, Perceptron<T>& perceptron)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("Failed to open checkpoint file: " + path);
+
+        std::int64_t step;
+        file.read(reinterpret_cast<char*>(&step), sizeof(step));
+        if (!file)
+            throw std::runtime_error("Failed to read checkpoint file: " + path);
+
+        PerceptronState<T> state;
+        Perceptron<T>::ReadState(file, state);
+        perceptron.SetState(state);
+        return step;
+    }
+
+    template<typename T>
+    void CheckpointWriter<T>::WriterLoop()
+    {
+        while (true)
+        {
+            int snapshotIndex;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _condition.wait(lock, [this]() { return _stop || _pendingIndex != -1; });
+
+                if (_pendingIndex == -1)
+                    return;
+
+                snapshotIndex = _pendingIndex;
+                _pendingIndex = -1;
+                _writingIndex = snapshotIndex;
+            }
+
+            std::exception_ptr error;
+            try
+            {
+                Write(snapshotIndex);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _writingIndex = -1;
+                if (error)
+                    _error = error;
+                else
+                    _writtenStep = _snapshotSteps[snapshotIndex];
+            }
+            _condition.notify_all();
+        }
+    }
+
+    //
+    // Checkpoint file: training step (64-bit integer) followed by perceptron state (see Perceptron<T>::WriteState()).
+    //
+    template<typename T>
+    void CheckpointWriter<T>::Write(int snapshotIndex)
+    {
+        std::string temporaryPath = _path + ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!file)
+                throw std::runtime_error("Failed to open checkpoint file: " + temporaryPath);
+
+            std::int64_t step = _snapshotSteps[snapshotIndex];
+            file.write(reinterpret_cast<const char*>(&step), sizeof(step));
+            Perceptron<T>::WriteState(file, _snapshots[snapshotIndex]);
+
+            file.close();
+            if (!file)
+                throw std::runtime_error("Failed to write checkpoint file: " + temporaryPath);
+        }
+        std::filesystem::rename(temporaryPath, _path);
+    }
+
+    template class CheckpointWriter<float>;
+    template class CheckpointWriter<double>;
+}
\ No newline at end of file
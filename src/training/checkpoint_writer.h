@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "perceptron.h"
+
+namespace NeuralNetwork::Training
+{
+    //
+    // Writes training checkpoints (weights, bias and momentum inertia) from a background thread.
+    // Save() only copies the state into one of two snapshot buffers, the file is written while training continues.
+    //      If the previous snapshot is still waiting to be written it is replaced by the new one,
+    //      so the trainer never waits for the disk.
+    // The file is written to a temporary file and then renamed, so the checkpoint on disk is always complete.
+    // Save() must be called from one thread (the trainer).
+    //
+    template<typename T>
+    class CheckpointWriter
+    {
+    private:
+        std::string _path;
+
+        PerceptronState<T> _snapshots[2];
+        long long _snapshotSteps[2];
+        int _writingIndex;
+        int _pendingIndex;
+        long long _writtenStep;
+
+        std::exception_ptr _error;
+        bool _stop;
+
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        std::thread _thread;
+
+    public:
+        explicit CheckpointWriter(const std::string& path);
+        ~CheckpointWriter();
+
+        CheckpointWriter(const CheckpointWriter<T>& other) = delete;
+        CheckpointWriter<T>& operator=(const CheckpointWriter<T>& other) = delete;
+
+        void Save(const Perceptron<T>& perceptron, long long step);
+        void Wait();
+
+        long long GetWrittenStep();
+
+        static long long Load(const std::string& path, Perceptron<T>& perceptron);
+
+    private:
+        void WriterLoop();
+        void Write(int snapshotIndex);
+    };
+}
\ No newline at end of file
@@ -0,0 +1,248 @@
+#include "distributed_trainer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "profiling/tracer.h"
+
+namespace NeuralNetwork::Training
+{
+    namespace
+    {
+        template<typename T>
+        void Reshape(Math::Matrix<T>& matrix, int rows, int cols)
+        {
+            if (matrix.GetRows() != rows || matrix.GetCols() != cols)
+                matrix = Math::Matrix<T>(rows, cols, false);
+        }
+    }
+
+    template<typename T>
+    DistributedTrainer<T>::DistributedTrainer(Perceptron<T>& perceptron, RingCommunicator& communicator) :
+        _perceptron(perceptron),
+        _communicator(communicator),
+        _reducedBucketsCount(0),
+        _stop(false)
+    {
+        int weightsCount = perceptron._weights.size();
+        _layers.resize(weightsCount + 1);
+        _derivatives.resize(weightsCount);
+        _deltas.resize(weightsCount);
+        _buckets.resize(weightsCount);
+        for (int i = 0; i < weightsCount; i++)
+        {
+            const Math::Matrix<T>& weights = perceptron._weights[i];
+            _buckets[i].resize(static_cast<std::size_t>(weights.GetRows()) * (weights.GetCols() + 1));
+        }
+
+        BroadcastParameters(0);
+        _communicationThread = std::thread(&DistributedTrainer<T>::CommunicationLoop, this);
+    }
+
+    template<typename T>
+    DistributedTrainer<T>::~DistributedTrainer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _condition.notify_all();
+        _communicationThread.join();
+    }
+
+    //
+    // Copies weights and bias of process @rootRank to all processes.
+    //
+    template<typename T>
+    void DistributedTrainer<T>::BroadcastParameters(int rootRank)
+    {
+        for (int i = 0; i < _perceptron._weights.size(); i++)
+        {
+            Math::Matrix<T>& weights = _perceptron._weights[i];
+            Math::Matrix<T>& bias = _perceptron._bias[i];
+            _communicator.Broadcast(&weights(0, 0), static_cast<std::size_t>(weights.GetRows()) * weights.GetCols(), rootRank);
+            _communicator.Broadcast(&bias(0, 0), bias.GetRows(), rootRank);
+        }
+        _perceptron.ReleasePackedWeights();
+    }
+
+    //
+    // Trains on one batch split between processes: @inputValues and @idealValues are the samples of this process,
+    //      shards may differ in size and may be empty. Gradients are averaged over samples of all processes.
+    //
+    template<typename T>
+    void DistributedTrainer<T>::TrainBatch(const std::vector<Math::Matrix<T>>& inputValues, const std::vector<Math::Matrix<T>>& idealValues,
+        T(*activationFunction)(T), T(*derivativeFunction)(T), bool cacheAfterActivationFunction, T learningRate, T moment)
+    {
+        if (!_perceptron._cacheIsInitialized)
+            throw std::logic_error("Cache is not initialized. Use InitTrainCache() method.");
+
+        if (inputValues.size() != idealValues.size())
+            throw std::invalid_argument("Inputs count not equal ideal values count");
+
+        int inputRows = _perceptron._layers.front().GetRows();
+        int outputRows = _perceptron._layers.back().GetRows();
+        int samplesCount = inputValues.size();
+        Reshape(_layers[0], inputRows, samplesCount);
+        Reshape(_idealValues, outputRows, samplesCount);
+        for (int sample = 0; sample < samplesCount; sample++)
+        {
+            const Math::Matrix<T>& input = inputValues[sample];
+            const Math::Matrix<T>& ideal = idealValues[sample];
+            if (input.GetRows() != inputRows || ideal.GetRows() != outputRows)
+                throw std::invalid_argument("Size of sample not equal size of input or output layer");
+
+            for (int row = 0; row < inputRows; row++)
+            {
+                _layers[0](row, sample) = input(row, 0);
+            }
+            for (int row = 0; row < outputRows; row++)
+            {
+                _idealValues(row, sample) = ideal(row, 0);
+            }
+        }
+
+        double totalSamplesCount = samplesCount;
+        _communicator.AllReduceSum(&totalSamplesCount, 1);
+        if (totalSamplesCount == 0.0)
+            return;
+
+        _perceptron.ReleasePackedWeights();
+
+        int weightsCount = _perceptron._weights.size();
+        for (int i = 0; i < weightsCount; i++)
+        {
+            _NN_TRACE_SCOPE("distributed", "Forward", i);
+            Math::Matrix<T>& output = _layers[i + 1];
+            Reshape(output, _perceptron._weights[i].GetRows(), samplesCount);
+            output
+                .MultAndStoreThis(_perceptron._weights[i], _layers[i])
+                .AddToEachCol(_perceptron._bias[i]);
+
+            if (cacheAfterActivationFunction)
+            {
+                output.ApplyFunction(activationFunction);
+                _derivatives[i] = output;
+                _derivatives[i].ApplyFunction(derivativeFunction);
+            }
+            else
+            {
+                _derivatives[i] = output;
+                _derivatives[i].ApplyFunction(derivativeFunction);
+                output.ApplyFunction(activationFunction);
+            }
+        }
+
+        // Gradients are summed over local samples here and over processes by all-reduce, then divided by the total count
+        for (int layerIndex = weightsCount - 1; layerIndex >= 0; layerIndex--)
+        {
+            {
+                _NN_TRACE_SCOPE("distributed", "Backward", layerIndex);
+                Math::Matrix<T>& deltas = _deltas[layerIndex];
+                if (layerIndex == weightsCount - 1)
+                {
+                    deltas = _layers[layerIndex + 1];
+                    deltas -= _idealValues;
+                    deltas *= static_cast<T>(2.0);
+                }
+                else
+                {
+                    Reshape(deltas, _perceptron._weights[layerIndex].GetRows(), samplesCount);
+                    Math::Matrix<T>::MultTransposedToMatrixAndStoreTo(_perceptron._weights[layerIndex + 1], _deltas[layerIndex + 1], deltas);
+                }
+                deltas.HadamardProductThis(_derivatives[layerIndex]);
+
+                Math::Matrix<T>::MultMatrixToTransposedAndStoreTo(deltas, _layers[layerIndex], _perceptron._deltasWeights[layerIndex]);
+                _perceptron._deltasBias[layerIndex].SumColsAndStoreThis(deltas);
+            }
+            SubmitBucket(layerIndex);
+        }
+        WaitBuckets();
+
+        T scale = static_cast<T>(1.0 / totalSamplesCount);
+        for (int layerIndex = 0; layerIndex < weightsCount; layerIndex++)
+        {
+            Math::Matrix<T>& deltasWeights = _perceptron._deltasWeights[layerIndex];
+            Math::Matrix<T>& deltasBias = _perceptron._deltasBias[layerIndex];
+            const T* bucket = _buckets[layerIndex].data();
+            std::size_t weightsSize = static_cast<std::size_t>(deltasWeights.GetRows()) * deltasWeights.GetCols();
+            std::transform(bucket, bucket + weightsSize, &deltasWeights(0, 0), [scale](T value) { return value * scale; });
+            std::transform(bucket + weightsSize, bucket + weightsSize + deltasBias.GetRows(), &deltasBias(0, 0), [scale](T value) { return value * scale; });
+
+            _perceptron.AdjustWeights(layerIndex, learningRate, moment);
+        }
+    }
+
+    template<typename T>
+    void DistributedTrainer<T>::CommunicationLoop()
+    {
+        while (true)
+        {
+            int bucketIndex;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _condition.wait(lock, [this]() { return _stop || !_pendingBuckets.empty(); });
+                if (_stop)
+                    return;
+
+                bucketIndex = _pendingBuckets.front();
+                _pendingBuckets.pop_front();
+            }
+
+            // After an error the ring is in unknown state, the rest of buckets is skipped
+            std::exception_ptr error;
+            if (_communicationError == nullptr)
+            {
+                try
+                {
+                    _NN_TRACE_SCOPE("distributed", "AllReduce", bucketIndex);
+                    _communicator.AllReduceSum(_buckets[bucketIndex].data(), _buckets[bucketIndex].size());
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (error != nullptr)
+                    _communicationError = error;
+                _reducedBucketsCount++;
+            }
+            _condition.notify_all();
+        }
+    }
+
+    template<typename T>
+    void DistributedTrainer<T>::SubmitBucket(int layerIndex)
+    {
+        const Math::Matrix<T>& deltasWeights = _perceptron._deltasWeights[layerIndex];
+        const Math::Matrix<T>& deltasBias = _perceptron._deltasBias[layerIndex];
+        std::vector<T>& bucket = _buckets[layerIndex];
+        std::size_t weightsSize = static_cast<std::size_t>(deltasWeights.GetRows()) * deltasWeights.GetCols();
+        std::copy(&deltasWeights(0, 0), &deltasWeights(0, 0) + weightsSize, bucket.begin());
+        std::copy(&deltasBias(0, 0), &deltasBias(0, 0) + deltasBias.GetRows(), bucket.begin() + weightsSize);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pendingBuckets.push_back(layerIndex);
+        }
+        _condition.notify_all();
+    }
+
+    template<typename T>
+    void DistributedTrainer<T>::WaitBuckets()
+    {
+        _NN_TRACE_SCOPE("distributed", "WaitAllReduce", -1);
+        std::unique_lock<std::mutex> lock(_mutex);
+        _condition.wait(lock, [this]() { return _reducedBucketsCount == static_cast<int>(_buckets.size()); });
+        _reducedBucketsCount = 0;
+
+        if (_communicationError != nullptr)
+            std::rethrow_exception(_communicationError);
+    }
+
+    template class DistributedTrainer<float>;
+    template class DistributedTrainer<double>;
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "perceptron.h"
+#include "math/matrix.h"
+#include "training/ring_communicator.h"
+
+namespace NeuralNetwork::Training
+{
+    //
+    // Data-parallel trainer for several processes: every process keeps a replica of the perceptron, computes
+    //      gradients on its own shard of the batch and the gradients are summed by ring all-reduce.
+    // Gradients of a layer are sent as soon as backward propagation computes them, a communication thread
+    //      reduces them while gradients of earlier layers are computed. All replicas apply the same averaged
+    //      gradients, so they stay equal.
+    // The constructor broadcasts parameters of rank 0, every process must construct the trainer with the same topology.
+    //
+    template<typename T>
+    class DistributedTrainer
+    {
+    private:
+        Perceptron<T>& _perceptron;
+        RingCommunicator& _communicator;
+
+        // Values of layers, derivatives and deltas of the local samples, one sample per column
+        std::vector<Math::Matrix<T>> _layers;
+        std::vector<Math::Matrix<T>> _derivatives;
+        std::vector<Math::Matrix<T>> _deltas;
+        Math::Matrix<T> _idealValues;
+
+        // Gradients of weights followed by gradients of bias for each layer, reduced as one message
+        std::vector<std::vector<T>> _buckets;
+
+        std::thread _communicationThread;
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        std::deque<int> _pendingBuckets;
+        int _reducedBucketsCount;
+        std::exception_ptr _communicationError;
+        bool _stop;
+
+    public:
+        DistributedTrainer(Perceptron<T>& perceptron, RingCommunicator& communicator);
+        ~DistributedTrainer();
+
+        DistributedTrainer(const DistributedTrainer<T>& other) = delete;
+        DistributedTrainer<T>& operator=(const DistributedTrainer<T>& other) = delete;
+
+        void BroadcastParameters(int rootRank);
+
+        void TrainBatch(const std::vector<Math::Matrix<T>>& inputValues, const std::vector<Math::Matrix<T>>& idealValues,
+            T(*activationFunction)(T), T(*derivativeFunction)(T), bool cacheAfterActivationFunction, T learningRate, T moment);
+
+    private:
+        void CommunicationLoop();
+        void SubmitBucket(int layerIndex);
+        void WaitBuckets();
+    };
+}
\ No newline at end of file
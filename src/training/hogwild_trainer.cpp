@@ -0,0 +1,238 @@
+#include "hogwild_trainer.h"
+
+#include <thread>
+#include <stdexcept>
+#include <string>
+
+#include "profiling/tracer.h"
+
+namespace NeuralNetwork::Training
+{
+    template<typename T>
+    struct HogwildTrainer<T>::Worker
+    {
+        std::vector<Math::Matrix<T>> layers;
+        std::vector<Math::Matrix<T>> derivatives;
+        std::vector<Math::Matrix<T>> deltas;
+        std::vector<Math::Matrix<T>> deltasWeights;
+        std::vector<Math::Matrix<T>> deltasBias;
+        std::vector<Math::Matrix<T>> deltasWeightsInertia;
+        std::vector<Math::Matrix<T>> deltasBiasInertia;
+        std::vector<int> nonZeroInputs;
+    };
+
+    template<typename T>
+    HogwildTrainer<T>::HogwildTrainer(Perceptron<T>& perceptron, int threadsCount) : _perceptron(perceptron)
+    {
+        if (threadsCount < 1)
+            throw std::invalid_argument("Threads count must be positive");
+
+        std::vector<int> neuronsCountPerLayer = perceptron.GetNeuronsCountPerLayer();
+        int layersCount = neuronsCountPerLayer.size();
+        for (int threadIndex = 0; threadIndex < threadsCount; threadIndex++)
+        {
+            std::unique_ptr<Worker> worker = std::make_unique<Worker>();
+            worker->layers.resize(layersCount);
+            for (int i = 0; i < layersCount; i++)
+            {
+                worker->layers[i] = Math::Matrix<T>(neuronsCountPerLayer[i], 1, false);
+            }
+            worker->derivatives.resize(layersCount - 1);
+            worker->deltas.resize(layersCount - 1);
+            worker->deltasWeights.resize(layersCount - 1);
+            worker->deltasBias.resize(layersCount - 1);
+            worker->deltasWeightsInertia.resize(layersCount - 1);
+            worker->deltasBiasInertia.resize(layersCount - 1);
+
+            for (int i = 0; i < layersCount - 1; i++)
+            {
+                int neuronsCountCurrent = neuronsCountPerLayer[i];
+                int neuronsCountNext = neuronsCountPerLayer[i + 1];
+
+                worker->derivatives[i] = Math::Matrix<T>(neuronsCountNext, 1, false);
+                worker->deltas[i] = Math::Matrix<T>(neuronsCountNext, 1, false);
+                worker->deltasWeights[i] = Math::Matrix<T>(neuronsCountNext, neuronsCountCurrent, false);
+                worker->deltasBias[i] = Math::Matrix<T>(neuronsCountNext, 1, false);
+                worker->deltasWeightsInertia[i] = Math::Matrix<T>(neuronsCountNext, neuronsCountCurrent);
+                worker->deltasBiasInertia[i] = Math::Matrix<T>(neuronsCountNext, 1);
+            }
+            worker->nonZeroInputs.reserve(neuronsCountPerLayer[0]);
+
+            _workers.push_back(std::move(worker));
+        }
+    }
+
+    template<typename T>
+    HogwildTrainer<T>::~HogwildTrainer() = default;
+
+    //
+    // Trains the network on every sample once. Samples are interleaved between worker threads,
+    //      the calling thread works as one of them.
+    //
+    template<typename T>
+    void HogwildTrainer<T>::TrainEpoch(const std::vector<Math::Matrix<T>>& inputValues, const std::vector<Math::Matrix<T>>& idealValues,
+        T(*activationFunction)(T), T(*derivativeFunction)(T), bool cacheAfterActivationFunction, T learningRate, T moment)
+    {
+        if (inputValues.size() != idealValues.size())
+            throw std::invalid_argument("Inputs count not equal ideal values count");
+
+        int inputRows = _perceptron._layers.front().GetRows();
+        int outputRows = _perceptron._layers.back().GetRows();
+        for (int sample = 0; sample < inputValues.size(); sample++)
+        {
+            if (inputValues[sample].GetRows() != inputRows || idealValues[sample].GetRows() != outputRows)
+                throw std::invalid_argument("Size of sample not equal size of input or output layer");
+        }
+
+        _perceptron.ReleasePackedWeights();
+
+        int threadsCount = _workers.size();
+        auto work = [&](int threadIndex)
+        {
+            Worker& worker = *_workers[threadIndex];
+            if (threadIndex > 0)
+            {
+                _NN_TRACE_THREAD_NAME("Hogwild worker " + std::to_string(threadIndex));
+            }
+            for (int sample = threadIndex; sample < inputValues.size(); sample += threadsCount)
+            {
+                TrainSample(worker, inputValues[sample], idealValues[sample],
+                    activationFunction, derivativeFunction, cacheAfterActivationFunction, learningRate, moment);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(threadsCount - 1);
+        for (int threadIndex = 1; threadIndex < threadsCount; threadIndex++)
+        {
+            threads.emplace_back(work, threadIndex);
+        }
+        work(0);
+
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    template<typename T>
+    int HogwildTrainer<T>::GetThreadsCount() const
+    {
+        return _workers.size();
+    }
+
+    //
+    // The same algorithm as Perceptron::ForwardPropagationWithCache() and Perceptron::BackwardPropagation(),
+    //      but with buffers and inertia of the worker, weights are adjusted right after each layer.
+    // Weighted sums of the first layer are computed only over non-zero inputs when less than half of them are non-zero.
+    //
+    template<typename T>
+    void HogwildTrainer<T>::TrainSample(Worker& worker, const Math::Matrix<T>& inputValues, const Math::Matrix<T>& idealValues,
+        T(*activationFunction)(T), T(*derivativeFunction)(T), bool cacheAfterActivationFunction, T learningRate, T moment)
+    {
+        _NN_TRACE_SCOPE("hogwild", "TrainSample", -1);
+        std::vector<Math::Matrix<T>>& weights = _perceptron._weights;
+        std::vector<Math::Matrix<T>>& bias = _perceptron._bias;
+        int weightsCount = weights.size();
+
+        worker.layers[0] = inputValues;
+        worker.nonZeroInputs.clear();
+        for (int row = 0; row < inputValues.GetRows(); row++)
+        {
+            if (inputValues(row, 0) != static_cast<T>(0.0))
+                worker.nonZeroInputs.push_back(row);
+        }
+        bool isSparseInput = 2 * worker.nonZeroInputs.size() < inputValues.GetRows();
+
+        for (int i = 0; i < weightsCount; i++)
+        {
+            if (i == 0 && isSparseInput)
+            {
+                Math::Matrix<T>& output = worker.layers[1];
+                for (int row = 0; row < output.GetRows(); row++)
+                {
+                    T sum = bias[0](row, 0);
+                    for (int col : worker.nonZeroInputs)
+                    {
+                        sum += weights[0](row, col) * inputValues(col, 0);
+                    }
+                    output(row, 0) = sum;
+                }
+            }
+            else
+            {
+                worker.layers[i + 1]
+                    .MultAndStoreThis(weights[i], worker.layers[i])
+                    .AddCol(bias[i], 0);
+            }
+
+            if (cacheAfterActivationFunction)
+            {
+                worker.layers[i + 1].ApplyFunction(activationFunction);
+                worker.derivatives[i] = worker.layers[i + 1];
+                worker.derivatives[i].ApplyFunction(derivativeFunction);
+            }
+            else
+            {
+                worker.derivatives[i] = worker.layers[i + 1];
+                worker.derivatives[i].ApplyFunction(derivativeFunction);
+                worker.layers[i + 1].ApplyFunction(activationFunction);
+            }
+        }
+
+        for (int layerIndex = weightsCount - 1; layerIndex >= 0; layerIndex--)
+        {
+            if (layerIndex == weightsCount - 1)
+            {
+                worker.deltas[layerIndex] = worker.layers[layerIndex + 1];
+                worker.deltas[layerIndex] -= idealValues;
+                worker.deltas[layerIndex] *= static_cast<T>(2.0);
+            }
+            else
+            {
+                Math::Matrix<T>::MultTransposedToMatrixAndStoreTo(weights[layerIndex + 1], worker.deltas[layerIndex + 1], worker.deltas[layerIndex]);
+            }
+            worker.deltas[layerIndex].HadamardProductThis(worker.derivatives[layerIndex]);
+        }
+
+        // Sparse update of the first layer: only columns of non-zero inputs are changed
+        int firstLayer = 0;
+        if (moment == static_cast<T>(0.0))
+        {
+            const Math::Matrix<T>& input = worker.layers[0];
+            const Math::Matrix<T>& delta = worker.deltas[0];
+            for (int row = 0; row < weights[0].GetRows(); row++)
+            {
+                T scaledDelta = learningRate * delta(row, 0);
+                for (int col : worker.nonZeroInputs)
+                {
+                    weights[0](row, col) -= scaledDelta * input(col, 0);
+                }
+                bias[0](row, 0) -= scaledDelta;
+            }
+            firstLayer = 1;
+        }
+
+        for (int layerIndex = firstLayer; layerIndex < weightsCount; layerIndex++)
+        {
+            Math::Matrix<T>::MultMatrixToTransposedAndStoreTo(worker.deltas[layerIndex], worker.layers[layerIndex], worker.deltasWeights[layerIndex]);
+            worker.deltasBias[layerIndex] = worker.deltas[layerIndex];
+
+            worker.deltasWeightsInertia[layerIndex] *= moment;
+            worker.deltasBiasInertia[layerIndex] *= moment;
+            worker.deltasWeights[layerIndex] *= (static_cast<T>(1.0) - moment);
+            worker.deltasBias[layerIndex] *= (static_cast<T>(1.0) - moment);
+            worker.deltasWeightsInertia[layerIndex] += worker.deltasWeights[layerIndex];
+            worker.deltasBiasInertia[layerIndex] += worker.deltasBias[layerIndex];
+
+            worker.deltasWeights[layerIndex].MultAndStoreThis(worker.deltasWeightsInertia[layerIndex], learningRate);
+            worker.deltasBias[layerIndex].MultAndStoreThis(worker.deltasBiasInertia[layerIndex], learningRate);
+
+            weights[layerIndex] -= worker.deltasWeights[layerIndex];
+            bias[layerIndex] -= worker.deltasBias[layerIndex];
+        }
+    }
+
+    template class HogwildTrainer<float>;
+    template class HogwildTrainer<double>;
+}
\ No newline at end of file
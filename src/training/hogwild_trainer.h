@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "perceptron.h"
+#include "math/matrix.h"
+
+namespace NeuralNetwork::Training
+{
+    //
+    // Asynchronous lock-free trainer (Hogwild!): worker threads run per-sample forward and backward
+    //      propagation with their own activation and delta buffers and update the shared weights
+    //      and bias of the perceptron without any synchronization.
+    // Updates are racy by design: a worker may read weights partially updated by another worker,
+    //      which is harmless for SGD when updates are sparse (e.g. sparse input features).
+    // With zero moment the first layer is updated only in the columns of non-zero inputs.
+    //
+    template<typename T>
+    class HogwildTrainer
+    {
+    private:
+        struct Worker;
+
+        Perceptron<T>& _perceptron;
+        std::vector<std::unique_ptr<Worker>> _workers;
+
+    public:
+        HogwildTrainer(Perceptron<T>& perceptron, int threadsCount);
+        ~HogwildTrainer();
+
+        HogwildTrainer(const HogwildTrainer<T>& other) = delete;
+        HogwildTrainer<T>& operator=(const HogwildTrainer<T>& other) = delete;
+
+        void TrainEpoch(const std::vector<Math::Matrix<T>>& inputValues, const std::vector<Math::Matrix<T>>& idealValues,
+            T(*activationFunction)(T), T(*derivativeFunction)(T), bool cacheAfterActivationFunction, T learningRate, T moment);
+
+        int GetThreadsCount() const;
+
+    private:
+        void TrainSample(Worker& worker, const Math::Matrix<T>& inputValues, const Math::Matrix<T>& idealValues,
+            T(*activationFunction)(T), T(*derivativeFunction)(T), bool cacheAfterActivationFunction, T learningRate, T moment);
+    };
+}
\ No newline at end of file
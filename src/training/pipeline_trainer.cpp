@@ -0,0 +1,522 @@
+#include "pipeline_trainer.h"
+
+#include <deque>
+#include <algorithm>
+#include <thread>
+#include <stdexcept>
+#include <string>
+#include <exception>
+
+#include "profiling/tracer.h"
+
+namespace NeuralNetwork::Training
+{
+    namespace
+    {
+        template<typename T>
+        void Reshape(Math::Matrix<T>& matrix, int rows, int cols)
+        {
+            if (matrix.GetRows() != rows || matrix.GetCols() != cols)
+                matrix = Math::Matrix<T>(rows, cols, false);
+        }
+    }
+
+    template<typename T>
+    struct PipelineTrainer<T>::Stage
+    {
+        struct Message
+        {
+            int microBatchIndex;
+            Math::Matrix<T> values;
+        };
+
+        int firstLayer;
+        int lastLayer;
+        int slotsCount;
+
+        // Stash of activations and derivatives for each micro-batch in flight, [slot][layer - firstLayer].
+        // Activations of the slot start with the stage input.
+        std::vector<std::vector<Math::Matrix<T>>> activations;
+        std::vector<std::vector<Math::Matrix<T>>> derivatives;
+
+        std::vector<Math::Matrix<T>> deltas;
+        std::vector<Math::Matrix<T>> deltasWeights;
+        std::vector<Math::Matrix<T>> deltasBias;
+        std::vector<Math::Matrix<T>> gradientWeights;
+        std::vector<Math::Matrix<T>> gradientBias;
+        Math::Matrix<T> inputGradient;
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<Message> forwardMessages;
+        std::deque<Message> backwardMessages;
+        int forwardsInFlight;
+        int backwardsDone;
+        bool stop;
+
+        std::thread thread;
+    };
+
+    template<typename T>
+    PipelineTrainer<T>::PipelineTrainer(Perceptron<T>& perceptron, int stagesCount, int microBatchSize) :
+        _perceptron(perceptron),
+        _microBatchSize(microBatchSize),
+        _activationFunction(nullptr),
+        _derivativeFunction(nullptr),
+        _cacheAfterActivationFunction(false),
+        _learningRate(0),
+        _moment(0),
+        _messagesInFlight(0),
+        _isAborted(false)
+    {
+        int weightsCount = perceptron._weights.size();
+        if (stagesCount < 1 || stagesCount > weightsCount)
+            throw std::invalid_argument("Stages count must be between 1 and the number of weight layers");
+
+        if (microBatchSize < 1)
+            throw std::invalid_argument("Micro-batch size must be positive");
+
+        // Contiguous layer ranges with approximately equal number of weights
+        long long weightsLeft = 0;
+        for (int i = 0; i < weightsCount; i++)
+        {
+            weightsLeft += static_cast<long long>(perceptron._weights[i].GetRows()) * perceptron._weights[i].GetCols();
+        }
+
+        int firstLayer = 0;
+        for (int stageIndex = 0; stageIndex < stagesCount; stageIndex++)
+        {
+            int stagesLeft = stagesCount - stageIndex;
+            long long target = weightsLeft / stagesLeft;
+
+            int lastLayer = firstLayer;
+            long long stageWeights = 0;
+            do
+            {
+                stageWeights += static_cast<long long>(perceptron._weights[lastLayer].GetRows()) * perceptron._weights[lastLayer].GetCols();
+                lastLayer++;
+            } while (lastLayer < weightsCount - (stagesLeft - 1) && (stagesLeft == 1 || stageWeights < target));
+            weightsLeft -= stageWeights;
+
+            std::unique_ptr<Stage> stage = std::make_unique<Stage>();
+            stage->firstLayer = firstLayer;
+            stage->lastLayer = lastLayer;
+            // One-forward-one-backward: stage (s) keeps at most (S - s) micro-batches in flight
+            stage->slotsCount = stagesCount - stageIndex;
+            stage->forwardsInFlight = 0;
+            stage->backwardsDone = 0;
+            stage->stop = false;
+
+            int layersCount = lastLayer - firstLayer;
+            stage->activations.assign(stage->slotsCount, std::vector<Math::Matrix<T>>(layersCount + 1));
+            stage->derivatives.assign(stage->slotsCount, std::vector<Math::Matrix<T>>(layersCount));
+            stage->deltas.resize(layersCount);
+            stage->deltasWeights.resize(layersCount);
+            stage->deltasBias.resize(layersCount);
+            stage->gradientWeights.resize(layersCount);
+            stage->gradientBias.resize(layersCount);
+            for (int k = 0; k < layersCount; k++)
+            {
+                const Math::Matrix<T>& weights = perceptron._weights[firstLayer + k];
+                stage->deltasWeights[k] = Math::Matrix<T>(weights.GetRows(), weights.GetCols(), false);
+                stage->deltasBias[k] = Math::Matrix<T>(weights.GetRows(), 1, false);
+                stage->gradientWeights[k] = Math::Matrix<T>(weights.GetRows(), weights.GetCols());
+                stage->gradientBias[k] = Math::Matrix<T>(weights.GetRows(), 1);
+            }
+
+            _stages.push_back(std::move(stage));
+            firstLayer = lastLayer;
+        }
+
+        for (int stageIndex = 0; stageIndex < stagesCount; stageIndex++)
+        {
+            _stages[stageIndex]->thread = std::thread(&PipelineTrainer<T>::StageLoop, this, stageIndex);
+        }
+    }
+
+    template<typename T>
+    PipelineTrainer<T>::~PipelineTrainer()
+    {
+        for (std::unique_ptr<Stage>& stage : _stages)
+        {
+            {
+                std::lock_guard<std::mutex> lock(stage->mutex);
+                stage->stop = true;
+            }
+            stage->condition.notify_one();
+        }
+
+        for (std::unique_ptr<Stage>& stage : _stages)
+        {
+            stage->thread.join();
+        }
+    }
+
+    //
+    // Trains the network on one batch. Samples are grouped into micro-batches of @_microBatchSize columns
+    //      which are pushed through the pipeline, gradients of the loss are averaged over the batch.
+    //
+    template<typename T>
+    void PipelineTrainer<T>::TrainBatch(const std::vector<Math::Matrix<T>>& inputValues, const std::vector<Math::Matrix<T>>& idealValues,
+        T(*activationFunction)(T), T(*derivativeFunction)(T), bool cacheAfterActivationFunction, T learningRate, T moment)
+    {
+        if (!_perceptron._cacheIsInitialized)
+            throw std::logic_error("Cache is not initialized. Use InitTrainCache() method.");
+
+        if (inputValues.size() != idealValues.size())
+            throw std::invalid_argument("Inputs count not equal ideal values count");
+
+        if (inputValues.empty())
+            return;
+
+        _NN_TRACE_SCOPE("pipeline", "TrainBatch", -1);
+        // Stages adjust their layers concurrently, so packed weights are released before they start
+        _perceptron.ReleasePackedWeights();
+        int inputRows = _perceptron._layers.front().GetRows();
+        int outputRows = _perceptron._layers.back().GetRows();
+        int samplesCount = inputValues.size();
+        int microBatchesCount = (samplesCount + _microBatchSize - 1) / _microBatchSize;
+
+        _inputMicroBatches.resize(microBatchesCount);
+        _idealMicroBatches.resize(microBatchesCount);
+        for (int microBatchIndex = 0; microBatchIndex < microBatchesCount; microBatchIndex++)
+        {
+            _NN_TRACE_SCOPE("batching", "AssembleMicroBatch", microBatchIndex);
+            int firstSample = microBatchIndex * _microBatchSize;
+            int samplesInMicroBatch = std::min(_microBatchSize, samplesCount - firstSample);
+
+            Math::Matrix<T>& inputs = _inputMicroBatches[microBatchIndex];
+            Math::Matrix<T>& ideals = _idealMicroBatches[microBatchIndex];
+            Reshape(inputs, inputRows, samplesInMicroBatch);
+            Reshape(ideals, outputRows, samplesInMicroBatch);
+
+            for (int sample = 0; sample < samplesInMicroBatch; sample++)
+            {
+                const Math::Matrix<T>& input = inputValues[firstSample + sample];
+                const Math::Matrix<T>& ideal = idealValues[firstSample + sample];
+                if (input.GetRows() != inputRows || ideal.GetRows() != outputRows)
+                    throw std::invalid_argument("Size of sample not equal size of input or output layer");
+
+                for (int row = 0; row < inputRows; row++)
+                {
+                    inputs(row, sample) = input(row, 0);
+                }
+                for (int row = 0; row < outputRows; row++)
+                {
+                    ideals(row, sample) = ideal(row, 0);
+                }
+            }
+        }
+
+        _activationFunction = activationFunction;
+        _derivativeFunction = derivativeFunction;
+        _cacheAfterActivationFunction = cacheAfterActivationFunction;
+        _learningRate = learningRate;
+        _moment = moment;
+
+        Stage& firstStage = *_stages.front();
+        {
+            std::lock_guard<std::mutex> lock(firstStage.mutex);
+            for (int microBatchIndex = 0; microBatchIndex < microBatchesCount; microBatchIndex++)
+            {
+                firstStage.forwardMessages.push_back({ microBatchIndex, _inputMicroBatches[microBatchIndex] });
+            }
+            AddMessagesInFlight(microBatchesCount);
+        }
+        firstStage.condition.notify_one();
+
+        std::exception_ptr error;
+        {
+            std::unique_lock<std::mutex> lock(_doneMutex);
+            _doneCondition.wait(lock, [this]() { return _messagesInFlight == 0; });
+            error = _error;
+            _error = nullptr;
+        }
+
+        if (error)
+        {
+            ResetStages();
+            std::rethrow_exception(error);
+        }
+    }
+
+    template<typename T>
+    int PipelineTrainer<T>::GetStagesCount() const
+    {
+        return _stages.size();
+    }
+
+    template<typename T>
+    int PipelineTrainer<T>::GetStageFirstLayer(int stageIndex) const
+    {
+        return _stages[stageIndex]->firstLayer;
+    }
+
+    template<typename T>
+    int PipelineTrainer<T>::GetStageLastLayer(int stageIndex) const
+    {
+        return _stages[stageIndex]->lastLayer;
+    }
+
+    //
+    // Backward messages have priority over forward ones, and a new forward is started only when
+    //      the stage has a free slot in the stash. This gives one-forward-one-backward schedule
+    //      after the pipeline is filled.
+    //
+    template<typename T>
+    void PipelineTrainer<T>::StageLoop(int stageIndex)
+    {
+        Stage& stage = *_stages[stageIndex];
+        _NN_TRACE_THREAD_NAME("Pipeline stage " + std::to_string(stageIndex));
+        while (true)
+        {
+            typename Stage::Message message;
+            bool isBackward;
+            {
+                std::unique_lock<std::mutex> lock(stage.mutex);
+                stage.condition.wait(lock, [this, &stage]()
+                    {
+                        // Dropped micro-batches never free their slots, so an aborted batch ignores the limit
+                        return stage.stop || !stage.backwardMessages.empty() ||
+                            (!stage.forwardMessages.empty() && (stage.forwardsInFlight < stage.slotsCount || _isAborted));
+                    });
+
+                if (stage.stop)
+                    return;
+
+                isBackward = !stage.backwardMessages.empty();
+                std::deque<typename Stage::Message>& messages = isBackward ? stage.backwardMessages : stage.forwardMessages;
+                message = std::move(messages.front());
+                messages.pop_front();
+
+                if (!isBackward)
+                    stage.forwardsInFlight++;
+            }
+
+            // Sent messages are counted under the mutex of the receiver before this one is done,
+            //      so the count can't drop to zero while the batch is still moving
+            if (!_isAborted)
+            {
+                try
+                {
+                    if (isBackward)
+                        StageBackward(stageIndex, message.microBatchIndex, message.values);
+                    else
+                        StageForward(stageIndex, message.microBatchIndex, message.values);
+                }
+                catch (...)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(_doneMutex);
+                        if (!_error)
+                            _error = std::current_exception();
+                    }
+                    AbortBatch();
+                }
+            }
+
+            bool isBatchDone;
+            {
+                std::lock_guard<std::mutex> lock(_doneMutex);
+                _messagesInFlight--;
+                isBatchDone = _messagesInFlight == 0;
+            }
+            if (isBatchDone)
+                _doneCondition.notify_one();
+        }
+    }
+
+    template<typename T>
+    void PipelineTrainer<T>::StageForward(int stageIndex, int microBatchIndex, Math::Matrix<T>& inputValues)
+    {
+        Stage& stage = *_stages[stageIndex];
+        int slot = microBatchIndex % stage.slotsCount;
+        std::vector<Math::Matrix<T>>& activations = stage.activations[slot];
+        std::vector<Math::Matrix<T>>& derivatives = stage.derivatives[slot];
+        int samplesCount = inputValues.GetCols();
+        _NN_TRACE_SCOPE("pipeline", "StageForward", microBatchIndex);
+
+        activations[0] = std::move(inputValues);
+        for (int k = 0; k < stage.lastLayer - stage.firstLayer; k++)
+        {
+            int layerIndex = stage.firstLayer + k;
+            Math::Matrix<T>& output = activations[k + 1];
+            Reshape(output, _perceptron._weights[layerIndex].GetRows(), samplesCount);
+
+            output
+                .MultAndStoreThis(_perceptron._weights[layerIndex], activations[k])
+                .AddToEachCol(_perceptron._bias[layerIndex]);
+
+            if (_cacheAfterActivationFunction)
+            {
+                output.ApplyFunction(_activationFunction);
+                derivatives[k] = output;
+                derivatives[k].ApplyFunction(_derivativeFunction);
+            }
+            else
+            {
+                derivatives[k] = output;
+                derivatives[k].ApplyFunction(_derivativeFunction);
+                output.ApplyFunction(_activationFunction);
+            }
+        }
+
+        if (stageIndex + 1 < static_cast<int>(_stages.size()))
+        {
+            Stage& nextStage = *_stages[stageIndex + 1];
+            {
+                std::lock_guard<std::mutex> lock(nextStage.mutex);
+                nextStage.forwardMessages.push_back({ microBatchIndex, activations.back() });
+                AddMessagesInFlight(1);
+            }
+            nextStage.condition.notify_one();
+            return;
+        }
+
+        // Last stage starts backward immediately: dL/da^L = 2 * (a^L - y) for MSE
+        Math::Matrix<T> outputGradient = activations.back();
+        outputGradient -= _idealMicroBatches[microBatchIndex];
+        outputGradient *= static_cast<T>(2.0);
+        StageBackward(stageIndex, microBatchIndex, outputGradient);
+    }
+
+    //
+    // Param @outputGradient is the gradient of the loss function with respect to the stage output.
+    //      Deltas are computed as in Perceptron::BackwardPropagation(), the gradient with respect
+    //      to the stage input (W^T * \delta) is sent to the previous stage.
+    //
+    template<typename T>
+    void PipelineTrainer<T>::StageBackward(int stageIndex, int microBatchIndex, Math::Matrix<T>& outputGradient)
+    {
+        Stage& stage = *_stages[stageIndex];
+        int slot = microBatchIndex % stage.slotsCount;
+        std::vector<Math::Matrix<T>>& activations = stage.activations[slot];
+        std::vector<Math::Matrix<T>>& derivatives = stage.derivatives[slot];
+        int samplesCount = outputGradient.GetCols();
+        _NN_TRACE_SCOPE("pipeline", "StageBackward", microBatchIndex);
+
+        for (int k = stage.lastLayer - stage.firstLayer - 1; k >= 0; k--)
+        {
+            int layerIndex = stage.firstLayer + k;
+            if (layerIndex == stage.lastLayer - 1)
+            {
+                stage.deltas[k] = std::move(outputGradient);
+            }
+            else
+            {
+                Reshape(stage.deltas[k], _perceptron._weights[layerIndex].GetRows(), samplesCount);
+                Math::Matrix<T>::MultTransposedToMatrixAndStoreTo(_perceptron._weights[layerIndex + 1], stage.deltas[k + 1], stage.deltas[k]);
+            }
+            stage.deltas[k].HadamardProductThis(derivatives[k]);
+
+            Math::Matrix<T>::MultMatrixToTransposedAndStoreTo(stage.deltas[k], activations[k], stage.deltasWeights[k]);
+            stage.deltasBias[k].SumColsAndStoreThis(stage.deltas[k]);
+            stage.gradientWeights[k] += stage.deltasWeights[k];
+            stage.gradientBias[k] += stage.deltasBias[k];
+        }
+
+        if (stageIndex > 0)
+        {
+            Reshape(stage.inputGradient, _perceptron._weights[stage.firstLayer].GetCols(), samplesCount);
+            Math::Matrix<T>::MultTransposedToMatrixAndStoreTo(_perceptron._weights[stage.firstLayer], stage.deltas[0], stage.inputGradient);
+
+            Stage& previousStage = *_stages[stageIndex - 1];
+            {
+                std::lock_guard<std::mutex> lock(previousStage.mutex);
+                previousStage.backwardMessages.push_back({ microBatchIndex, std::move(stage.inputGradient) });
+                AddMessagesInFlight(1);
+            }
+            previousStage.condition.notify_one();
+        }
+
+        bool isBatchDone;
+        {
+            std::lock_guard<std::mutex> lock(stage.mutex);
+            stage.forwardsInFlight--;
+            stage.backwardsDone++;
+            isBatchDone = stage.backwardsDone == static_cast<int>(_inputMicroBatches.size());
+        }
+
+        if (isBatchDone)
+            StageAdjustWeights(stageIndex);
+    }
+
+    template<typename T>
+    void PipelineTrainer<T>::StageAdjustWeights(int stageIndex)
+    {
+        _NN_TRACE_SCOPE("pipeline", "StageAdjustWeights", stageIndex);
+        Stage& stage = *_stages[stageIndex];
+        int samplesCount = 0;
+        for (const Math::Matrix<T>& inputs : _inputMicroBatches)
+        {
+            samplesCount += inputs.GetCols();
+        }
+        T scale = static_cast<T>(1.0) / samplesCount;
+
+        for (int k = 0; k < stage.lastLayer - stage.firstLayer; k++)
+        {
+            int layerIndex = stage.firstLayer + k;
+            _perceptron._deltasWeights[layerIndex].MultAndStoreThis(stage.gradientWeights[k], scale);
+            _perceptron._deltasBias[layerIndex].MultAndStoreThis(stage.gradientBias[k], scale);
+            _perceptron.AdjustWeights(layerIndex, _learningRate, _moment);
+
+            stage.gradientWeights[k].Fill(0);
+            stage.gradientBias[k].Fill(0);
+        }
+
+        std::lock_guard<std::mutex> lock(stage.mutex);
+        stage.backwardsDone = 0;
+    }
+
+    //
+    // Called under the mutex of the stage receiving the messages, before it can take them.
+    //
+    template<typename T>
+    void PipelineTrainer<T>::AddMessagesInFlight(int count)
+    {
+        std::lock_guard<std::mutex> lock(_doneMutex);
+        _messagesInFlight += count;
+    }
+
+    //
+    // Wakes up stages waiting for a free slot, so they drop the rest of the batch.
+    //
+    template<typename T>
+    void PipelineTrainer<T>::AbortBatch()
+    {
+        _isAborted = true;
+        for (std::unique_ptr<Stage>& stage : _stages)
+        {
+            // Taking the mutex orders the flag with the wait predicate of the stage
+            {
+                std::lock_guard<std::mutex> lock(stage->mutex);
+            }
+            stage->condition.notify_one();
+        }
+    }
+
+    //
+    // Drops the state of an abandoned batch. Called when no message is in flight, so stages are idle.
+    //
+    template<typename T>
+    void PipelineTrainer<T>::ResetStages()
+    {
+        for (std::unique_ptr<Stage>& stage : _stages)
+        {
+            std::lock_guard<std::mutex> lock(stage->mutex);
+            stage->forwardMessages.clear();
+            stage->backwardMessages.clear();
+            stage->forwardsInFlight = 0;
+            stage->backwardsDone = 0;
+            for (int k = 0; k < stage->lastLayer - stage->firstLayer; k++)
+            {
+                stage->gradientWeights[k].Fill(0);
+                stage->gradientBias[k].Fill(0);
+            }
+        }
+        _isAborted = false;
+    }
+
+    template class PipelineTrainer<float>;
+    template class PipelineTrainer<double>;
+}
\ No newline at end of file
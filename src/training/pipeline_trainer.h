@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+
+#include "perceptron.h"
+#include "math/matrix.h"
+
+namespace NeuralNetwork::Training
+{
+    //
+    // Pipeline-parallel trainer: contiguous ranges of layers (stages) are assigned to their own threads
+    //      and micro-batches are streamed through the stages with one-forward-one-backward schedule.
+    // Each stage updates only its own weights, so they stay in the cache of the core running the stage.
+    // Gradients are averaged over the whole batch and applied once per TrainBatch() call.
+    // An exception thrown by a stage abandons the batch: other stages drop their messages and TrainBatch()
+    //      rethrows it once the pipeline is empty, layers adjusted before the failure keep the new weights.
+    //
+    template<typename T>
+    class PipelineTrainer
+    {
+    private:
+        struct Stage;
+
+        Perceptron<T>& _perceptron;
+        int _microBatchSize;
+        std::vector<std::unique_ptr<Stage>> _stages;
+
+        std::vector<Math::Matrix<T>> _inputMicroBatches;
+        std::vector<Math::Matrix<T>> _idealMicroBatches;
+
+        T(*_activationFunction)(T);
+        T(*_derivativeFunction)(T);
+        bool _cacheAfterActivationFunction;
+        T _learningRate;
+        T _moment;
+
+        // Messages queued or being processed by stages, the batch is finished when none is left
+        std::mutex _doneMutex;
+        std::condition_variable _doneCondition;
+        int _messagesInFlight;
+        std::exception_ptr _error;
+        // Set on the first exception, stages then drop messages without processing them
+        std::atomic<bool> _isAborted;
+
+    public:
+        PipelineTrainer(Perceptron<T>& perceptron, int stagesCount, int microBatchSize);
+        ~PipelineTrainer();
+
+        PipelineTrainer(const PipelineTrainer<T>& other) = delete;
+        PipelineTrainer<T>& operator=(const PipelineTrainer<T>& other) = delete;
+
+        void TrainBatch(const std::vector<Math::Matrix<T>>& inputValues, const std::vector<Math::Matrix<T>>& idealValues,
+            T(*activationFunction)(T), T(*derivativeFunction)(T), bool cacheAfterActivationFunction, T learningRate, T moment);
+
+        int GetStagesCount() const;
+        int GetStageFirstLayer(int stageIndex) const;
+        int GetStageLastLayer(int stageIndex) const;
+
+    private:
+        void StageLoop(int stageIndex);
+        void StageForward(int stageIndex, int microBatchIndex, Math::Matrix<T>& inputValues);
+        void StageBackward(int stageIndex, int microBatchIndex, Math::Matrix<T>& outputGradient);
+        void StageAdjustWeights(int stageIndex);
+        void AddMessagesInFlight(int count);
+        void AbortBatch();
+        void ResetStages();
+    };
+}
\ No newline at end of file
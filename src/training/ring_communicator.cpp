@@ -0,0 +1,411 @@
+#include "ring_communicator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#define _NN_SOCKETS
+#endif
+
+namespace NeuralNetwork::Training
+{
+    namespace
+    {
+        constexpr char UnixEndpointPrefix[] = "unix:";
+        // Broadcast forwards data in pieces, so every process of the ring sends while receiving the next piece
+        constexpr std::size_t BroadcastPieceSize = 1 << 20;
+
+#ifdef _NN_SOCKETS
+#ifdef MSG_NOSIGNAL
+        constexpr int SendFlags = MSG_NOSIGNAL;
+#else
+        constexpr int SendFlags = 0;
+#endif
+
+        bool IsUnixEndpoint(const std::string& endpoint)
+        {
+            return endpoint.compare(0, sizeof(UnixEndpointPrefix) - 1, UnixEndpointPrefix) == 0;
+        }
+
+        sockaddr_un GetUnixAddress(const std::string& endpoint)
+        {
+            std::string path = endpoint.substr(sizeof(UnixEndpointPrefix) - 1);
+            sockaddr_un address = {};
+            if (path.empty() || path.size() >= sizeof(address.sun_path))
+                throw std::invalid_argument("Invalid Unix socket path in endpoint " + endpoint);
+
+            address.sun_family = AF_UNIX;
+            std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+            return address;
+        }
+
+        addrinfo* ResolveTcpAddress(const std::string& endpoint, bool isPassive)
+        {
+            std::size_t separator = endpoint.rfind(':');
+            if (separator == std::string::npos || separator == 0 || separator + 1 == endpoint.size())
+                throw std::invalid_argument("Endpoint must be host:port or unix:path, got " + endpoint);
+
+            addrinfo hints = {};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_flags = isPassive ? AI_PASSIVE : 0;
+
+            addrinfo* addresses = nullptr;
+            if (getaddrinfo(endpoint.substr(0, separator).c_str(), endpoint.substr(separator + 1).c_str(), &hints, &addresses) != 0)
+                throw std::runtime_error("Failed to resolve endpoint " + endpoint);
+            return addresses;
+        }
+
+        void WriteAll(int socket, const char* data, std::size_t size)
+        {
+            while (size > 0)
+            {
+                ssize_t written = send(socket, data, size, SendFlags);
+                if (written < 0 && errno == EINTR)
+                    continue;
+                if (written <= 0)
+                    throw std::runtime_error("Failed to send to the next process");
+                data += written;
+                size -= written;
+            }
+        }
+
+        void ReadAll(int socket, char* data, std::size_t size)
+        {
+            while (size > 0)
+            {
+                ssize_t received = recv(socket, data, size, 0);
+                if (received < 0 && errno == EINTR)
+                    continue;
+                if (received <= 0)
+                    throw std::runtime_error("Failed to receive from the previous process");
+                data += received;
+                size -= received;
+            }
+        }
+
+        void SetNonBlocking(int socket)
+        {
+            fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+        }
+
+        void SetNoDelay(int socket)
+        {
+            int flag = 1;
+            setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+        }
+#endif
+    }
+
+    RingCommunicator::RingCommunicator(int rank, const std::vector<std::string>& endpoints, int timeoutMs) :
+        _rank(rank),
+        _worldSize(endpoints.size()),
+        _timeoutMs(timeoutMs),
+        _listenSocket(-1),
+        _nextSocket(-1),
+        _previousSocket(-1)
+    {
+        if (endpoints.empty())
+            throw std::invalid_argument("Endpoints list must not be empty");
+
+        if (rank < 0 || rank >= _worldSize)
+            throw std::out_of_range("Rank out of range of endpoints");
+
+        if (timeoutMs < 1)
+            throw std::invalid_argument("Timeout must be positive");
+
+        if (_worldSize == 1)
+            return;
+
+        try
+        {
+            Listen(endpoints[rank]);
+            ConnectToNext(endpoints[(rank + 1) % _worldSize]);
+            AcceptPrevious();
+        }
+        catch (...)
+        {
+            Close();
+            throw;
+        }
+    }
+
+    RingCommunicator::~RingCommunicator()
+    {
+        Close();
+    }
+
+    int RingCommunicator::GetRank() const
+    {
+        return _rank;
+    }
+
+    int RingCommunicator::GetWorldSize() const
+    {
+        return _worldSize;
+    }
+
+    //
+    // Replaces @values with their element-wise sums over all processes.
+    // Ring algorithm: values are split into one chunk per process, reduce-scatter passes partial sums around
+    //      the ring until every process has one chunk summed over all processes, all-gather passes the summed
+    //      chunks around. Every process sends 2 * (N - 1) / N of the values, whatever the number of processes N.
+    // Every chunk is summed by one process, so all processes get bitwise equal results.
+    //
+    template<typename T>
+    void RingCommunicator::AllReduceSum(T* values, std::size_t count)
+    {
+        if (_worldSize == 1 || count == 0)
+            return;
+
+        auto chunkBegin = [this, count](int chunk)
+        {
+            return count * chunk / _worldSize;
+        };
+        auto chunkSize = [&chunkBegin](int chunk)
+        {
+            return chunkBegin(chunk + 1) - chunkBegin(chunk);
+        };
+
+        _receiveBuffer.resize(sizeof(T) * ((count + _worldSize - 1) / _worldSize));
+        T* received = reinterpret_cast<T*>(_receiveBuffer.data());
+
+        for (int step = 0; step < _worldSize - 1; step++)
+        {
+            int sendChunk = (_rank - step + _worldSize) % _worldSize;
+            int receiveChunk = (_rank - step - 1 + _worldSize) % _worldSize;
+            Exchange(reinterpret_cast<const char*>(values + chunkBegin(sendChunk)), sizeof(T) * chunkSize(sendChunk),
+                _receiveBuffer.data(), sizeof(T) * chunkSize(receiveChunk));
+
+            T* target = values + chunkBegin(receiveChunk);
+            for (std::size_t i = 0; i < chunkSize(receiveChunk); i++)
+            {
+                target[i] += received[i];
+            }
+        }
+
+        for (int step = 0; step < _worldSize - 1; step++)
+        {
+            int sendChunk = (_rank + 1 - step + _worldSize) % _worldSize;
+            int receiveChunk = (_rank - step + _worldSize) % _worldSize;
+            Exchange(reinterpret_cast<const char*>(values + chunkBegin(sendChunk)), sizeof(T) * chunkSize(sendChunk),
+                reinterpret_cast<char*>(values + chunkBegin(receiveChunk)), sizeof(T) * chunkSize(receiveChunk));
+        }
+    }
+
+    //
+    // Copies @values of process @rootRank to all processes, data is forwarded along the ring.
+    //
+    template<typename T>
+    void RingCommunicator::Broadcast(T* values, std::size_t count, int rootRank)
+    {
+        if (rootRank < 0 || rootRank >= _worldSize)
+            throw std::out_of_range("Root rank out of range");
+
+        if (_worldSize == 1)
+            return;
+
+        char* data = reinterpret_cast<char*>(values);
+        std::size_t size = sizeof(T) * count;
+        bool isLast = (_rank + 1) % _worldSize == rootRank;
+        for (std::size_t offset = 0; offset < size; offset += BroadcastPieceSize)
+        {
+            std::size_t pieceSize = std::min(BroadcastPieceSize, size - offset);
+            if (_rank != rootRank)
+                Exchange(nullptr, 0, data + offset, pieceSize);
+            if (!isLast)
+                Exchange(data + offset, pieceSize, nullptr, 0);
+        }
+    }
+
+    void RingCommunicator::Listen(const std::string& endpoint)
+    {
+#ifdef _NN_SOCKETS
+        if (IsUnixEndpoint(endpoint))
+        {
+            sockaddr_un address = GetUnixAddress(endpoint);
+            _listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (_listenSocket < 0)
+                throw std::runtime_error("Failed to create socket");
+
+            unlink(address.sun_path);
+            if (bind(_listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+                throw std::runtime_error("Failed to bind " + endpoint);
+            _unixSocketPath = address.sun_path;
+        }
+        else
+        {
+            addrinfo* addresses = ResolveTcpAddress(endpoint, true);
+            _listenSocket = socket(addresses->ai_family, addresses->ai_socktype, addresses->ai_protocol);
+            int reuse = 1;
+            bool isBound = _listenSocket >= 0 &&
+                setsockopt(_listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == 0 &&
+                bind(_listenSocket, addresses->ai_addr, addresses->ai_addrlen) == 0;
+            freeaddrinfo(addresses);
+            if (!isBound)
+                throw std::runtime_error("Failed to bind " + endpoint);
+        }
+
+        if (listen(_listenSocket, 1) != 0)
+            throw std::runtime_error("Failed to listen on " + endpoint);
+#else
+        throw std::runtime_error("Sockets are not supported on this platform");
+#endif
+    }
+
+    void RingCommunicator::ConnectToNext(const std::string& endpoint)
+    {
+#ifdef _NN_SOCKETS
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(_timeoutMs);
+        while (true)
+        {
+            bool isConnected = false;
+            if (IsUnixEndpoint(endpoint))
+            {
+                sockaddr_un address = GetUnixAddress(endpoint);
+                _nextSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+                isConnected = _nextSocket >= 0 && connect(_nextSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+            }
+            else
+            {
+                addrinfo* addresses = ResolveTcpAddress(endpoint, false);
+                _nextSocket = socket(addresses->ai_family, addresses->ai_socktype, addresses->ai_protocol);
+                isConnected = _nextSocket >= 0 && connect(_nextSocket, addresses->ai_addr, addresses->ai_addrlen) == 0;
+                freeaddrinfo(addresses);
+                if (isConnected)
+                    SetNoDelay(_nextSocket);
+            }
+
+            if (isConnected)
+                break;
+
+            // The next process may not listen yet
+            if (_nextSocket >= 0)
+                close(_nextSocket);
+            _nextSocket = -1;
+            if (std::chrono::steady_clock::now() >= deadline)
+                throw std::runtime_error("Failed to connect to " + endpoint);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+
+        std::int32_t rank = _rank;
+        WriteAll(_nextSocket, reinterpret_cast<const char*>(&rank), sizeof(rank));
+#endif
+    }
+
+    void RingCommunicator::AcceptPrevious()
+    {
+#ifdef _NN_SOCKETS
+        pollfd listenPoll = { _listenSocket, POLLIN, 0 };
+        int ready = poll(&listenPoll, 1, _timeoutMs);
+        if (ready <= 0)
+            throw std::runtime_error("Previous process did not connect");
+
+        _previousSocket = accept(_listenSocket, nullptr, nullptr);
+        if (_previousSocket < 0)
+            throw std::runtime_error("Failed to accept the previous process");
+
+        if (_unixSocketPath.empty())
+            SetNoDelay(_previousSocket);
+
+        std::int32_t previousRank = -1;
+        ReadAll(_previousSocket, reinterpret_cast<char*>(&previousRank), sizeof(previousRank));
+        if (previousRank != (_rank - 1 + _worldSize) % _worldSize)
+            throw std::runtime_error("Unexpected process connected, endpoints lists of processes differ");
+
+        SetNonBlocking(_nextSocket);
+        SetNonBlocking(_previousSocket);
+#endif
+    }
+
+    //
+    // Sends @sendSize bytes to the next process while receiving @receiveSize bytes from the previous one.
+    // Both directions progress together, so processes sending to each other can't block on full socket buffers.
+    //
+    void RingCommunicator::Exchange(const char* sendData, std::size_t sendSize, char* receiveData, std::size_t receiveSize)
+    {
+#ifdef _NN_SOCKETS
+        std::size_t sent = 0;
+        std::size_t received = 0;
+        while (sent < sendSize || received < receiveSize)
+        {
+            pollfd sockets[2];
+            int socketsCount = 0;
+            int sendIndex = -1;
+            int receiveIndex = -1;
+            if (sent < sendSize)
+            {
+                sockets[socketsCount] = { _nextSocket, POLLOUT, 0 };
+                sendIndex = socketsCount++;
+            }
+            if (received < receiveSize)
+            {
+                sockets[socketsCount] = { _previousSocket, POLLIN, 0 };
+                receiveIndex = socketsCount++;
+            }
+
+            int ready = poll(sockets, socketsCount, _timeoutMs);
+            if (ready < 0 && errno == EINTR)
+                continue;
+            if (ready < 0)
+                throw std::runtime_error("Failed to poll sockets");
+            if (ready == 0)
+                throw std::runtime_error("Timeout of data exchange between processes");
+
+            if (sendIndex >= 0 && sockets[sendIndex].revents != 0)
+            {
+                ssize_t written = send(_nextSocket, sendData + sent, sendSize - sent, SendFlags);
+                if (written < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                    throw std::runtime_error("Failed to send to the next process");
+                if (written > 0)
+                    sent += written;
+            }
+
+            if (receiveIndex >= 0 && sockets[receiveIndex].revents != 0)
+            {
+                ssize_t readSize = recv(_previousSocket, receiveData + received, receiveSize - received, 0);
+                if (readSize == 0)
+                    throw std::runtime_error("Previous process closed the connection");
+                if (readSize < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                    throw std::runtime_error("Failed to receive from the previous process");
+                if (readSize > 0)
+                    received += readSize;
+            }
+        }
+#endif
+    }
+
+    void RingCommunicator::Close()
+    {
+#ifdef _NN_SOCKETS
+        for (int* socket : { &_nextSocket, &_previousSocket, &_listenSocket })
+        {
+            if (*socket >= 0)
+                close(*socket);
+            *socket = -1;
+        }
+
+        if (!_unixSocketPath.empty())
+            unlink(_unixSocketPath.c_str());
+        _unixSocketPath.clear();
+#endif
+    }
+
+    template void RingCommunicator::AllReduceSum<float>(float* values, std::size_t count);
+    template void RingCommunicator::AllReduceSum<double>(double* values, std::size_t count);
+    template void RingCommunicator::Broadcast<float>(float* values, std::size_t count, int rootRank);
+    template void RingCommunicator::Broadcast<double>(double* values, std::size_t count, int rootRank);
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+namespace NeuralNetwork::Training
+{
+    //
+    // Ring of processes connected by sockets for collective operations of data-parallel training.
+    // Process @rank listens on endpoints[@rank], connects to the next process and accepts the previous one.
+    // Endpoints are "host:port" for TCP and "unix:path" for Unix domain sockets, every process must get
+    //      the same list. Processes may start in any order, the connection is retried for @timeoutMs milliseconds.
+    // All processes must call collective operations in the same order with the same sizes.
+    //
+    class RingCommunicator
+    {
+    private:
+        int _rank;
+        int _worldSize;
+        int _timeoutMs;
+        int _listenSocket;
+        int _nextSocket;
+        int _previousSocket;
+        std::string _unixSocketPath;
+
+        std::vector<char> _receiveBuffer;
+
+    public:
+        RingCommunicator(int rank, const std::vector<std::string>& endpoints, int timeoutMs = 30000);
+        ~RingCommunicator();
+
+        RingCommunicator(const RingCommunicator& other) = delete;
+        RingCommunicator& operator=(const RingCommunicator& other) = delete;
+
+        int GetRank() const;
+        int GetWorldSize() const;
+
+        template<typename T>
+        void AllReduceSum(T* values, std::size_t count);
+        template<typename T>
+        void Broadcast(T* values, std::size_t count, int rootRank);
+
+    private:
+        void Listen(const std::string& endpoint);
+        void ConnectToNext(const std::string& endpoint);
+        void AcceptPrevious();
+        void Exchange(const char* sendData, std::size_t sendSize, char* receiveData, std::size_t receiveSize);
+        void Close();
+    };
+}
\ No newline at end of file
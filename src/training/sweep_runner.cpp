@@ -0,0 +1,304 @@
+#include "sweep_runner.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace NeuralNetwork::Training
+{
+    template<typename T>
+    SweepRunner<T>::SweepRunner(const std::vector<Math::Matrix<T>>& inputValues, const std::vector<Math::Matrix<T>>& idealValues,
+        T(*activationFunction)(T), T(*derivativeFunction)(T), bool cacheAfterActivationFunction, Threading::ThreadPool& pool) :
+        _inputValues(inputValues),
+        _idealValues(idealValues),
+        _activationFunction(activationFunction),
+        _derivativeFunction(derivativeFunction),
+        _cacheAfterActivationFunction(cacheAfterActivationFunction),
+        _pool(pool),
+        _rungEpochsCount(0),
+        _cancelFraction(0),
+        _jobsInProgress(0)
+    {
+        if (inputValues.size() != idealValues.size() || inputValues.empty())
+            throw std::invalid_argument("Inputs count must be equal ideal values count and not zero");
+    }
+
+    template<typename T>
+    SweepRunner<T>::~SweepRunner()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        for (std::unique_ptr<Job>& job : _jobs)
+        {
+            job->cancelRequested = true;
+        }
+        _condition.wait(lock, [this]() { return _jobsInProgress == 0; });
+    }
+
+    //
+    // Enables early cancellation: every @rungEpochsCount epochs a job is cancelled when its loss is in the worst
+    //      @cancelFraction of the losses reported at the same epoch. Zero @rungEpochsCount disables cancellation.
+    //
+    template<typename T>
+    void SweepRunner<T>::SetEarlyCancellation(int rungEpochsCount, T cancelFraction)
+    {
+        if (rungEpochsCount < 0 || cancelFraction < 0 || cancelFraction >= 1)
+            throw std::invalid_argument("Rung epochs count must be non-negative and cancel fraction in [0, 1)");
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_jobsInProgress > 0)
+            throw std::logic_error("Early cancellation can't be changed while the sweep is running");
+
+        _rungEpochsCount = rungEpochsCount;
+        _cancelFraction = cancelFraction;
+    }
+
+    template<typename T>
+    int SweepRunner<T>::AddConfiguration(const SweepConfiguration<T>& configuration)
+    {
+        if (configuration.neuronsCountPerLayer.size() < 2)
+            throw std::invalid_argument("Configuration must have at least two layers");
+
+        if (configuration.neuronsCountPerLayer.front() != _inputValues[0].GetRows() ||
+            configuration.neuronsCountPerLayer.back() != _idealValues[0].GetRows())
+            throw std::invalid_argument("Input and output layers of configuration must match the training set");
+
+        if (configuration.epochsCount < 1)
+            throw std::invalid_argument("Epochs count must be positive");
+
+        std::unique_ptr<Job> job = std::make_unique<Job>();
+        job->configuration = configuration;
+        job->epochsDone = 0;
+        job->loss = 0;
+        job->isStarted = false;
+        job->isCancelled = false;
+        job->cancelRequested = false;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push_back(std::move(job));
+        return _jobs.size() - 1;
+    }
+
+    //
+    // Submits all configurations which were not started yet to the pool.
+    //
+    template<typename T>
+    void SweepRunner<T>::Start()
+    {
+        std::vector<Job*> jobs;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (std::unique_ptr<Job>& job : _jobs)
+            {
+                if (job->isStarted)
+                    continue;
+
+                job->isStarted = true;
+                jobs.push_back(job.get());
+                _jobsInProgress++;
+            }
+        }
+
+        for (Job* job : jobs)
+        {
+            _pool.Submit([this, job]() { TrainRung(*job); });
+        }
+    }
+
+    //
+    // Waits for all started configurations, rethrows the first exception thrown by a job.
+    //
+    template<typename T>
+    void SweepRunner<T>::Wait()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _condition.wait(lock, [this]() { return _jobsInProgress == 0; });
+
+        if (_error)
+        {
+            std::exception_ptr error = _error;
+            _error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    template<typename T>
+    void SweepRunner<T>::Run()
+    {
+        Start();
+        Wait();
+    }
+
+    //
+    // Stops training of the configuration after the current epoch, the configuration is reported as cancelled.
+    //
+    template<typename T>
+    void SweepRunner<T>::Cancel(int configurationIndex)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (configurationIndex < 0 || configurationIndex >= _jobs.size())
+            throw std::out_of_range("Configuration index out of range");
+
+        _jobs[configurationIndex]->cancelRequested = true;
+    }
+
+    //
+    // Returns results of started configurations: finished ones sorted by loss, then cancelled ones sorted by loss.
+    //
+    template<typename T>
+    std::vector<SweepResult<T>> SweepRunner<T>::GetSummary() const
+    {
+        std::vector<SweepResult<T>> results;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (int i = 0; i < _jobs.size(); i++)
+            {
+                const Job& job = *_jobs[i];
+                if (job.isStarted)
+                    results.push_back({ i, job.epochsDone, job.loss, job.isCancelled });
+            }
+        }
+
+        std::sort(results.begin(), results.end(), [](const SweepResult<T>& lhv, const SweepResult<T>& rhv)
+            {
+                if (lhv.isCancelled != rhv.isCancelled)
+                    return rhv.isCancelled;
+                if (lhv.loss != rhv.loss)
+                    return lhv.loss < rhv.loss;
+                return lhv.configurationIndex < rhv.configurationIndex;
+            });
+        return results;
+    }
+
+    //
+    // Trained perceptron of the configuration, available when the sweep is not running.
+    //
+    template<typename T>
+    const Perceptron<T>& SweepRunner<T>::GetPerceptron(int configurationIndex) const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (configurationIndex < 0 || configurationIndex >= _jobs.size())
+            throw std::out_of_range("Configuration index out of range");
+
+        if (_jobsInProgress > 0)
+            throw std::logic_error("Perceptrons can't be accessed while the sweep is running");
+
+        const std::unique_ptr<Perceptron<T>>& perceptron = _jobs[configurationIndex]->perceptron;
+        if (!perceptron)
+            throw std::logic_error("Configuration was not trained");
+
+        return *perceptron;
+    }
+
+    template<typename T>
+    void SweepRunner<T>::TrainRung(Job& job)
+    {
+        try
+        {
+            const SweepConfiguration<T>& configuration = job.configuration;
+            if (!job.perceptron)
+            {
+                job.perceptron = std::make_unique<Perceptron<T>>(configuration.neuronsCountPerLayer);
+                job.perceptron->InitializeWeights(configuration.initialization, configuration.seed);
+                job.perceptron->InitTrainCache();
+            }
+
+            int rungEpochsCount = _rungEpochsCount > 0 ? _rungEpochsCount : configuration.epochsCount;
+            int lastEpoch = std::min(job.epochsDone + rungEpochsCount, configuration.epochsCount);
+            int epochsDone = job.epochsDone;
+            T loss = job.loss;
+            bool isCancelled = false;
+            while (epochsDone < lastEpoch)
+            {
+                if (job.cancelRequested)
+                {
+                    isCancelled = true;
+                    break;
+                }
+
+                loss = TrainEpoch(*job.perceptron, configuration);
+                epochsDone++;
+            }
+
+            if (!isCancelled && _rungEpochsCount > 0 && epochsDone < configuration.epochsCount)
+                isCancelled = !ReportRungLoss(epochsDone / _rungEpochsCount - 1, loss);
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                job.epochsDone = epochsDone;
+                job.loss = loss;
+                job.isCancelled = isCancelled;
+            }
+
+            if (isCancelled || epochsDone == configuration.epochsCount)
+            {
+                job.perceptron->ClearTrainCache();
+                FinishJob();
+                return;
+            }
+
+            // Submitted from the worker, so the next rung goes to its own queue and is usually taken by the same worker
+            _pool.Submit([this, &job]() { TrainRung(job); });
+        }
+        catch (...)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (!_error)
+                    _error = std::current_exception();
+                job.isCancelled = true;
+            }
+            FinishJob();
+        }
+    }
+
+    template<typename T>
+    T SweepRunner<T>::TrainEpoch(Perceptron<T>& perceptron, const SweepConfiguration<T>& configuration) const
+    {
+        T lossSum = 0;
+        for (int sample = 0; sample < _inputValues.size(); sample++)
+        {
+            const Math::Matrix<T>& ideal = _idealValues[sample];
+
+            perceptron.SetInputValues(_inputValues[sample]);
+            const Math::Matrix<T>& output = perceptron.ForwardPropagationWithCache(_activationFunction, _derivativeFunction, _cacheAfterActivationFunction);
+            for (int row = 0; row < output.GetRows(); row++)
+            {
+                T error = output(row, 0) - ideal(row, 0);
+                lossSum += error * error / output.GetRows();
+            }
+
+            perceptron.BackwardPropagation(ideal, configuration.learningRate, configuration.moment);
+        }
+        return lossSum / _inputValues.size();
+    }
+
+    //
+    // Records @loss at rung @rungIndex, returns false when the job is in the worst fraction of the rung.
+    //
+    template<typename T>
+    bool SweepRunner<T>::ReportRungLoss(int rungIndex, T loss)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_rungLosses.size() <= rungIndex)
+            _rungLosses.resize(rungIndex + 1);
+
+        std::vector<T>& losses = _rungLosses[rungIndex];
+        losses.push_back(loss);
+        if (losses.size() < 2)
+            return true;
+
+        int betterCount = std::count_if(losses.begin(), losses.end(), [loss](T other) { return other < loss; });
+        return betterCount < losses.size() * (1 - _cancelFraction);
+    }
+
+    template<typename T>
+    void SweepRunner<T>::FinishJob()
+    {
+        // Notified under the lock: the runner may be destroyed right after the lock is released
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobsInProgress--;
+        _condition.notify_all();
+    }
+
+    template class SweepRunner<float>;
+    template class SweepRunner<double>;
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <condition_variable>
+
+#include "perceptron.h"
+#include "math/matrix.h"
+#include "threading/thread_pool.h"
+
+namespace NeuralNetwork::Training
+{
+    template<typename T>
+    struct SweepConfiguration
+    {
+        std::vector<int> neuronsCountPerLayer;
+        WeightsInitialization initialization;
+        unsigned long long seed;
+        T learningRate;
+        T moment;
+        int epochsCount;
+    };
+
+    template<typename T>
+    struct SweepResult
+    {
+        int configurationIndex;
+        int epochsDone;
+        // Mean training loss (MSE) of the last epoch
+        T loss;
+        bool isCancelled;
+    };
+
+    //
+    // Trains many independent perceptrons concurrently on the work-stealing thread pool.
+    // Every configuration owns its perceptron and train cache, only the training set is shared (read-only).
+    // A job trains a rung of epochs per task and submits the next rung as a new task of the same worker,
+    //      so a worker keeps its model hot in cache while idle workers steal jobs which were not started yet.
+    // Early cancellation (asynchronous successive halving): after every rung a job compares its loss with
+    //      the losses reported at that rung so far and is cancelled when it is in the worst @cancelFraction of them.
+    //
+    template<typename T>
+    class SweepRunner
+    {
+    private:
+        struct Job
+        {
+            SweepConfiguration<T> configuration;
+            std::unique_ptr<Perceptron<T>> perceptron;
+            int epochsDone;
+            T loss;
+            bool isStarted;
+            bool isCancelled;
+            std::atomic<bool> cancelRequested;
+        };
+
+        std::vector<Math::Matrix<T>> _inputValues;
+        std::vector<Math::Matrix<T>> _idealValues;
+        T(*_activationFunction)(T);
+        T(*_derivativeFunction)(T);
+        bool _cacheAfterActivationFunction;
+        Threading::ThreadPool& _pool;
+
+        int _rungEpochsCount;
+        T _cancelFraction;
+        // Losses reported by jobs at the end of each rung
+        std::vector<std::vector<T>> _rungLosses;
+
+        std::vector<std::unique_ptr<Job>> _jobs;
+        int _jobsInProgress;
+        std::exception_ptr _error;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _condition;
+
+    public:
+        SweepRunner(const std::vector<Math::Matrix<T>>& inputValues, const std::vector<Math::Matrix<T>>& idealValues,
+            T(*activationFunction)(T), T(*derivativeFunction)(T), bool cacheAfterActivationFunction = false,
+            Threading::ThreadPool& pool = Threading::ThreadPool::GetDefault());
+        ~SweepRunner();
+
+        SweepRunner(const SweepRunner<T>& other) = delete;
+        SweepRunner<T>& operator=(const SweepRunner<T>& other) = delete;
+
+        void SetEarlyCancellation(int rungEpochsCount, T cancelFraction);
+        int AddConfiguration(const SweepConfiguration<T>& configuration);
+
+        void Start();
+        void Wait();
+        void Run();
+        void Cancel(int configurationIndex);
+
+        std::vector<SweepResult<T>> GetSummary() const;
+        const Perceptron<T>& GetPerceptron(int configurationIndex) const;
+
+    private:
+        void TrainRung(Job& job);
+        T TrainEpoch(Perceptron<T>& perceptron, const SweepConfiguration<T>& configuration) const;
+        bool ReportRungLoss(int rungIndex, T loss);
+        void FinishJob();
+    };
+}
\ No newline at end of file
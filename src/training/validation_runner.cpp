@@ -0,0 +1,246 @@
+#include "validation_runner.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace NeuralNetwork::Training
+{
+    template<typename T>
+    ValidationRunner<T>::ValidationRunner(const std::vector<Math::Matrix<T>>& inputValues, const std::vector<Math::Matrix<T>>& idealValues,
+        T(*activationFunction)(T), int patience, T threshold, int batchSize, Threading::ThreadPool* pool) :
+        _activationFunction(activationFunction),
+        _threshold(threshold),
+        _patience(patience),
+        _ownPool(pool == nullptr ? std::make_unique<Threading::ThreadPool>(1) : nullptr),
+        _pool(pool == nullptr ? *_ownPool : *pool),
+        _evaluationsInProgress(0)
+    {
+        if (inputValues.size() != idealValues.size() || inputValues.empty())
+            throw std::invalid_argument("Inputs count must be equal ideal values count and not zero");
+
+        if (batchSize < 1 || patience < 1)
+            throw std::invalid_argument("Batch size and patience must be positive");
+
+        int inputRows = inputValues[0].GetRows();
+        int outputRows = idealValues[0].GetRows();
+        int samplesCount = inputValues.size();
+        for (int firstSample = 0; firstSample < samplesCount; firstSample += batchSize)
+        {
+            int samplesInBatch = std::min(batchSize, samplesCount - firstSample);
+            Math::Matrix<T> inputs(inputRows, samplesInBatch, false);
+            Math::Matrix<T> ideals(outputRows, samplesInBatch, false);
+
+            for (int sample = 0; sample < samplesInBatch; sample++)
+            {
+                const Math::Matrix<T>& input = inputValues[firstSample + sample];
+                const Math::Matrix<T>& ideal = idealValues[firstSample + sample];
+                if (input.GetRows() != inputRows || ideal.GetRows() != outputRows)
+                    throw std::invalid_argument("Samples must have the same size");
+
+                for (int row = 0; row < inputRows; row++)
+                {
+                    inputs(row, sample) = input(row, 0);
+                }
+                for (int row = 0; row < outputRows; row++)
+                {
+                    ideals(row, sample) = ideal(row, 0);
+                }
+            }
+
+            _inputBatches.push_back(std::move(inputs));
+            _idealBatches.push_back(std::move(ideals));
+        }
+    }
+
+    template<typename T>
+    ValidationRunner<T>::~ValidationRunner()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _condition.wait(lock, [this]() { return _evaluationsInProgress == 0; });
+    }
+
+    //
+    // Takes a snapshot of the weights of @perceptron after epoch @epoch and evaluates it in background.
+    // Must be called between training steps, so the snapshot is consistent.
+    //
+    template<typename T>
+    void ValidationRunner<T>::Submit(const Perceptron<T>& perceptron, int epoch)
+    {
+        std::vector<int> neuronsCountPerLayer = perceptron.GetNeuronsCountPerLayer();
+        if (neuronsCountPerLayer.front() != _inputBatches[0].GetRows() || neuronsCountPerLayer.back() != _idealBatches[0].GetRows())
+            throw std::invalid_argument("Size of input or output layer not equal size of validation samples");
+
+        std::unique_ptr<Perceptron<T>> snapshot;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_freeSnapshots.empty())
+            {
+                snapshot = std::move(_freeSnapshots.back());
+                _freeSnapshots.pop_back();
+            }
+            _evaluationsInProgress++;
+        }
+
+        if (!snapshot)
+            snapshot = std::make_unique<Perceptron<T>>(neuronsCountPerLayer);
+        snapshot->CopyParametersFrom(perceptron);
+
+        Perceptron<T>* snapshotPointer = snapshot.release();
+        _pool.Submit([this, snapshotPointer, epoch]()
+            {
+                std::unique_ptr<Perceptron<T>> snapshot(snapshotPointer);
+                ValidationResult<T> result;
+                std::exception_ptr error;
+                try
+                {
+                    result = Evaluate(*snapshot, epoch);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+
+                // Notified under the lock: the runner may be destroyed right after the lock is released
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (error)
+                {
+                    if (!_error)
+                        _error = error;
+                }
+                else
+                    _results.push_back(result);
+                _freeSnapshots.push_back(std::move(snapshot));
+                _evaluationsInProgress--;
+                _condition.notify_all();
+            });
+    }
+
+    //
+    // Waits for all submitted evaluations, rethrows the first exception thrown by an evaluation.
+    //
+    template<typename T>
+    void ValidationRunner<T>::Wait()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _condition.wait(lock, [this]() { return _evaluationsInProgress == 0; });
+
+        if (_error)
+        {
+            std::exception_ptr error = _error;
+            _error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    //
+    // Returns results of finished evaluations sorted by epoch.
+    //
+    template<typename T>
+    std::vector<ValidationResult<T>> ValidationRunner<T>::GetResults()
+    {
+        std::vector<ValidationResult<T>> results;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            results = _results;
+        }
+
+        std::sort(results.begin(), results.end(), [](const ValidationResult<T>& lhv, const ValidationResult<T>& rhv) { return lhv.epoch < rhv.epoch; });
+        return results;
+    }
+
+    template<typename T>
+    bool ValidationRunner<T>::GetBestResult(ValidationResult<T>& result)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        int bestIndex = FindBestResult();
+        if (bestIndex < 0)
+            return false;
+
+        result = _results[bestIndex];
+        return true;
+    }
+
+    template<typename T>
+    bool ValidationRunner<T>::ShouldStop()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        int bestIndex = FindBestResult();
+        if (bestIndex < 0)
+            return false;
+
+        int lastEpoch = _results[bestIndex].epoch;
+        for (const ValidationResult<T>& result : _results)
+        {
+            lastEpoch = std::max(lastEpoch, result.epoch);
+        }
+        return lastEpoch - _results[bestIndex].epoch >= _patience;
+    }
+
+    template<typename T>
+    ValidationResult<T> ValidationRunner<T>::Evaluate(const Perceptron<T>& snapshot, int epoch)
+    {
+        std::mutex totalsMutex;
+        T lossSum = 0;
+        int correctCount = 0;
+        int samplesCount = 0;
+
+        _pool.ParallelFor(0, _inputBatches.size(), 1, [&](int begin, int end)
+            {
+                T chunkLossSum = 0;
+                int chunkCorrectCount = 0;
+                int chunkSamplesCount = 0;
+
+                for (int batchIndex = begin; batchIndex < end; batchIndex++)
+                {
+                    const Math::Matrix<T>& ideals = _idealBatches[batchIndex];
+                    Math::Matrix<T> outputs = snapshot.ForwardPropagationBatch(_inputBatches[batchIndex], _activationFunction);
+
+                    for (int sample = 0; sample < outputs.GetCols(); sample++)
+                    {
+                        int outputIndex = 0;
+                        int idealIndex = 0;
+                        for (int row = 0; row < outputs.GetRows(); row++)
+                        {
+                            T error = outputs(row, sample) - ideals(row, sample);
+                            chunkLossSum += error * error / outputs.GetRows();
+
+                            if (outputs(row, sample) > outputs(outputIndex, sample))
+                                outputIndex = row;
+                            if (ideals(row, sample) > ideals(idealIndex, sample))
+                                idealIndex = row;
+                        }
+
+                        if (outputs.GetRows() == 1)
+                            chunkCorrectCount += (outputs(0, sample) > _threshold) == (ideals(0, sample) > _threshold);
+                        else
+                            chunkCorrectCount += outputIndex == idealIndex;
+                    }
+                    chunkSamplesCount += outputs.GetCols();
+                }
+
+                std::lock_guard<std::mutex> lock(totalsMutex);
+                lossSum += chunkLossSum;
+                correctCount += chunkCorrectCount;
+                samplesCount += chunkSamplesCount;
+            });
+
+        return { epoch, lossSum / samplesCount, static_cast<T>(correctCount) / samplesCount };
+    }
+
+    template<typename T>
+    int ValidationRunner<T>::FindBestResult() const
+    {
+        int bestIndex = -1;
+        for (int i = 0; i < _results.size(); i++)
+        {
+            const ValidationResult<T>& result = _results[i];
+            if (bestIndex < 0 || result.loss < _results[bestIndex].loss ||
+                (result.loss == _results[bestIndex].loss && result.epoch < _results[bestIndex].epoch))
+                bestIndex = i;
+        }
+        return bestIndex;
+    }
+
+    template class ValidationRunner<float>;
+    template class ValidationRunner<double>;
+}
\ No newline at end of file
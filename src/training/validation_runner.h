@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "perceptron.h"
+#include "math/matrix.h"
+#include "threading/thread_pool.h"
+
+namespace NeuralNetwork::Training
+{
+    template<typename T>
+    struct ValidationResult
+    {
+        int epoch;
+        T loss;
+        T accuracy;
+    };
+
+    //
+    // Evaluates a held-out set on a snapshot of the perceptron weights in background while training continues.
+    // Submit() only copies weights and bias into a free snapshot, the evaluation runs in batched mode
+    //      (ForwardPropagationBatch()) on a task of @pool, by default on an own pool of one thread, so evaluations
+    //      never queue on the default pool used by Matrix kernels of the trainer.
+    // Loss is MSE as in training. A sample is correct when the index of the maximal output matches the ideal one,
+    //      or, for a single output, when output and ideal value are on the same side of @threshold.
+    // Early stopping: ShouldStop() becomes true when the best loss was not improved during @patience epochs.
+    //
+    template<typename T>
+    class ValidationRunner
+    {
+    private:
+        std::vector<Math::Matrix<T>> _inputBatches;
+        std::vector<Math::Matrix<T>> _idealBatches;
+        T(*_activationFunction)(T);
+        T _threshold;
+        int _patience;
+        std::unique_ptr<Threading::ThreadPool> _ownPool;
+        Threading::ThreadPool& _pool;
+
+        std::vector<std::unique_ptr<Perceptron<T>>> _freeSnapshots;
+        std::vector<ValidationResult<T>> _results;
+        int _evaluationsInProgress;
+        std::exception_ptr _error;
+
+        std::mutex _mutex;
+        std::condition_variable _condition;
+
+    public:
+        ValidationRunner(const std::vector<Math::Matrix<T>>& inputValues, const std::vector<Math::Matrix<T>>& idealValues,
+            T(*activationFunction)(T), int patience, T threshold = 0, int batchSize = 64,
+            Threading::ThreadPool* pool = nullptr);
+        ~ValidationRunner();
+
+        ValidationRunner(const ValidationRunner<T>& other) = delete;
+        ValidationRunner<T>& operator=(const ValidationRunner<T>& other) = delete;
+
+        void Submit(const Perceptron<T>& perceptron, int epoch);
+        void Wait();
+
+        std::vector<ValidationResult<T>> GetResults();
+        bool GetBestResult(ValidationResult<T>& result);
+        bool ShouldStop();
+
+    private:
+        ValidationResult<T> Evaluate(const Perceptron<T>& snapshot, int epoch);
+        int FindBestResult() const;
+    };
+}
\ No newline at end of file
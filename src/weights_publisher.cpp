@@ -0,0 +1,224 @@
+#include "weights_publisher.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace NeuralNetwork
+{
+    //
+    // Publishes a copy of @perceptron as the first snapshot.
+    // Param @freezeSnapshots packs weights of every snapshot by FreezeForInference().
+    // Param @maxReadersCount is the number of Reader objects which may exist at once.
+    //
+    template<typename T>
+    WeightsPublisher<T>::WeightsPublisher(const Perceptron<T>& perceptron, bool freezeSnapshots, int maxReadersCount) :
+        _neuronsCountPerLayer(perceptron.GetNeuronsCountPerLayer()),
+        _freezeSnapshots(freezeSnapshots),
+        _current(nullptr),
+        _version(0),
+        _epoch(1),
+        _readerSlotsCount(maxReadersCount)
+    {
+        if (maxReadersCount < 1)
+            throw std::invalid_argument("Readers count must be positive");
+
+        _readerSlots = std::make_unique<ReaderSlot[]>(maxReadersCount);
+        for (int i = 0; i < maxReadersCount; i++)
+        {
+            _readerSlots[i].epoch = 0;
+            _readerSlots[i].isUsed = false;
+        }
+
+        _current = CreateSnapshot(perceptron).release();
+        _version = 1;
+    }
+
+    //
+    // All readers must be destroyed before the publisher.
+    //
+    template<typename T>
+    WeightsPublisher<T>::~WeightsPublisher()
+    {
+        delete _current.load();
+        for (const RetiredSnapshot& retired : _retiredSnapshots)
+        {
+            delete retired.snapshot;
+        }
+    }
+
+    //
+    // Copies weights and bias of @perceptron into a new snapshot and makes it current, returns its version.
+    // Readers which are in a read section keep their snapshot, next Begin() calls get the new one.
+    // Publications are serialized, the perceptron must have the topology of the first one.
+    //
+    template<typename T>
+    std::uint64_t WeightsPublisher<T>::Publish(const Perceptron<T>& perceptron)
+    {
+        std::lock_guard<std::mutex> lock(_publishMutex);
+        std::unique_ptr<Snapshot> snapshot = CreateSnapshot(perceptron);
+        std::uint64_t version = snapshot->version;
+
+        Snapshot* previous = _current.exchange(snapshot.release());
+        _version = version;
+        // A reader could load the previous snapshot only after announcing an epoch not newer than this one
+        std::uint64_t epoch = _epoch.fetch_add(1);
+        _retiredSnapshots.push_back({ previous, epoch });
+
+        ReclaimRetiredSnapshots();
+        return version;
+    }
+
+    template<typename T>
+    std::uint64_t WeightsPublisher<T>::GetVersion() const
+    {
+        return _version;
+    }
+
+    //
+    // Reclaims replaced snapshots which no reader can use anymore, returns their count.
+    // Publish() reclaims too, call this method to release memory when publications stop.
+    //
+    template<typename T>
+    int WeightsPublisher<T>::Reclaim()
+    {
+        std::lock_guard<std::mutex> lock(_publishMutex);
+        return ReclaimRetiredSnapshots();
+    }
+
+    template<typename T>
+    std::unique_ptr<typename WeightsPublisher<T>::Snapshot> WeightsPublisher<T>::CreateSnapshot(const Perceptron<T>& perceptron)
+    {
+        std::unique_ptr<Snapshot> snapshot;
+        if (!_freeSnapshots.empty())
+        {
+            snapshot = std::move(_freeSnapshots.back());
+            _freeSnapshots.pop_back();
+        }
+        else
+        {
+            snapshot.reset(new Snapshot{ Perceptron<T>(_neuronsCountPerLayer), 0 });
+        }
+
+        // A reused frozen snapshot is repacked by the copy into its existing panels
+        snapshot->perceptron.CopyParametersFrom(perceptron);
+        if (_freezeSnapshots && !snapshot->perceptron.IsFrozenForInference())
+            snapshot->perceptron.FreezeForInference();
+        snapshot->version = _version + 1;
+        return snapshot;
+    }
+
+    template<typename T>
+    int WeightsPublisher<T>::ReclaimRetiredSnapshots()
+    {
+        std::uint64_t oldestEpoch = std::numeric_limits<std::uint64_t>::max();
+        for (int i = 0; i < _readerSlotsCount; i++)
+        {
+            std::uint64_t epoch = _readerSlots[i].epoch.load();
+            if (epoch != 0)
+                oldestEpoch = std::min(oldestEpoch, epoch);
+        }
+
+        int reclaimedCount = 0;
+        auto isReclaimed = [this, oldestEpoch, &reclaimedCount](const RetiredSnapshot& retired)
+        {
+            if (retired.epoch >= oldestEpoch)
+                return false;
+
+            if (_freeSnapshots.size() < FreeSnapshotsLimit)
+                _freeSnapshots.emplace_back(retired.snapshot);
+            else
+                delete retired.snapshot;
+            reclaimedCount++;
+            return true;
+        };
+        _retiredSnapshots.erase(std::remove_if(_retiredSnapshots.begin(), _retiredSnapshots.end(), isReclaimed), _retiredSnapshots.end());
+        return reclaimedCount;
+    }
+
+    template<typename T>
+    typename WeightsPublisher<T>::ReaderSlot& WeightsPublisher<T>::AcquireReaderSlot()
+    {
+        for (int i = 0; i < _readerSlotsCount; i++)
+        {
+            bool isUsed = false;
+            if (_readerSlots[i].isUsed.compare_exchange_strong(isUsed, true))
+                return _readerSlots[i];
+        }
+        throw std::runtime_error("All reader slots are used");
+    }
+
+    template<typename T>
+    WeightsPublisher<T>::Reader::Reader(WeightsPublisher<T>& publisher) :
+        _publisher(publisher),
+        _slot(publisher.AcquireReaderSlot()),
+        _snapshot(nullptr)
+    {
+    }
+
+    template<typename T>
+    WeightsPublisher<T>::Reader::~Reader()
+    {
+        if (_snapshot != nullptr)
+            End();
+        _slot.isUsed = false;
+    }
+
+    //
+    // Starts a read section and returns the current snapshot. Wait-free: a store of the epoch and a load of the pointer.
+    // The snapshot must not be used after End().
+    //
+    template<typename T>
+    const Perceptron<T>& WeightsPublisher<T>::Reader::Begin()
+    {
+        if (_snapshot != nullptr)
+            throw std::logic_error("Read section is already started");
+
+        // Sequentially consistent store and load: the publisher either sees the epoch or the reader sees the new pointer
+        _slot.epoch.store(_publisher._epoch.load());
+        _snapshot = _publisher._current.load();
+        return _snapshot->perceptron;
+    }
+
+    template<typename T>
+    void WeightsPublisher<T>::Reader::End()
+    {
+        if (_snapshot == nullptr)
+            throw std::logic_error("Read section is not started");
+
+        _snapshot = nullptr;
+        _slot.epoch.store(0, std::memory_order_release);
+    }
+
+    //
+    // Returns version of the snapshot of the current read section.
+    //
+    template<typename T>
+    std::uint64_t WeightsPublisher<T>::Reader::GetVersion() const
+    {
+        if (_snapshot == nullptr)
+            throw std::logic_error("Read section is not started");
+
+        return _snapshot->version;
+    }
+
+    template<typename T>
+    Math::Matrix<T> WeightsPublisher<T>::Reader::ForwardPropagationBatch(const Math::Matrix<T>& inputValues, T(*activationFunction)(T))
+    {
+        const Perceptron<T>& perceptron = Begin();
+        try
+        {
+            Math::Matrix<T> outputValues = perceptron.ForwardPropagationBatch(inputValues, activationFunction);
+            End();
+            return outputValues;
+        }
+        catch (...)
+        {
+            End();
+            throw;
+        }
+    }
+
+    template class WeightsPublisher<float>;
+    template class WeightsPublisher<double>;
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include "perceptron.h"
+#include "math/matrix.h"
+
+namespace NeuralNetwork
+{
+    //
+    // Publication of weights for serving while training (read-copy-update).
+    // The trainer updates its own perceptron and calls Publish(), which copies the weights into an immutable
+    //      snapshot and swaps it in atomically. Readers never lock or wait: a reader announces the current epoch
+    //      in its own slot, loads the snapshot pointer and uses the snapshot until End().
+    // Replaced snapshots are reclaimed when no reader has announced an epoch older than their replacement,
+    //      reclaimed snapshots are reused by next publications together with their packed panels, so steady state
+    //      publishing does not allocate.
+    //
+    template<typename T>
+    class WeightsPublisher
+    {
+    public:
+        class Reader;
+
+    private:
+        struct Snapshot
+        {
+            Perceptron<T> perceptron;
+            std::uint64_t version;
+        };
+
+        struct RetiredSnapshot
+        {
+            Snapshot* snapshot;
+            std::uint64_t epoch;
+        };
+
+        // One cache line per reader, so readers don't invalidate lines of each other
+        struct alignas(64) ReaderSlot
+        {
+            // Epoch announced by the reader, 0 when the reader is outside of a read section
+            std::atomic<std::uint64_t> epoch;
+            std::atomic<bool> isUsed;
+        };
+
+        std::vector<int> _neuronsCountPerLayer;
+        bool _freezeSnapshots;
+
+        std::atomic<Snapshot*> _current;
+        std::atomic<std::uint64_t> _version;
+        std::atomic<std::uint64_t> _epoch;
+        std::unique_ptr<ReaderSlot[]> _readerSlots;
+        int _readerSlotsCount;
+
+        // Accessed only by publishing, which is serialized by the mutex
+        std::mutex _publishMutex;
+        std::vector<RetiredSnapshot> _retiredSnapshots;
+        std::vector<std::unique_ptr<Snapshot>> _freeSnapshots;
+
+        static constexpr int FreeSnapshotsLimit = 2;
+
+    public:
+        WeightsPublisher(const Perceptron<T>& perceptron, bool freezeSnapshots = false, int maxReadersCount = 64);
+        ~WeightsPublisher();
+
+        WeightsPublisher(const WeightsPublisher<T>& other) = delete;
+        WeightsPublisher<T>& operator=(const WeightsPublisher<T>& other) = delete;
+
+        std::uint64_t Publish(const Perceptron<T>& perceptron);
+        std::uint64_t GetVersion() const;
+        int Reclaim();
+
+        //
+        // Read handle of one thread. Begin() returns the current snapshot, it stays valid until End().
+        //
+        class Reader
+        {
+        private:
+            WeightsPublisher<T>& _publisher;
+            ReaderSlot& _slot;
+            const Snapshot* _snapshot;
+
+        public:
+            explicit Reader(WeightsPublisher<T>& publisher);
+            ~Reader();
+
+            Reader(const Reader& other) = delete;
+            Reader& operator=(const Reader& other) = delete;
+
+            const Perceptron<T>& Begin();
+            void End();
+            std::uint64_t GetVersion() const;
+
+            Math::Matrix<T> ForwardPropagationBatch(const Math::Matrix<T>& inputValues, T(*activationFunction)(T));
+        };
+
+    private:
+        std::unique_ptr<Snapshot> CreateSnapshot(const Perceptron<T>& perceptron);
+        int ReclaimRetiredSnapshots();
+        ReaderSlot& AcquireReaderSlot();
+    };
+}
\ No newline at end of file
@@ -0,0 +1,352 @@
+//
+// Benchmark: times Matrix kernels and layers of a perceptron, reporting hardware counters next to timings.
+// Usage:
+//      NeuralNetworkBenchmark [--double] [--size <N>] [--repetitions <N>] [--layers <N>[,<N>...]] [--steps <N>] [--parallel]
+// Kernels run on N x N matrices (N x 1 vectors for GEMV), the fastest of the repetitions is reported together
+//      with its counters. Layers are measured by training a perceptron for the given steps with trace spans
+//      recorded with counters, this needs the library built with ENABLE_TRACING.
+// GFLOP/s and GB/s are derived from analytic operation counts and the least memory traffic of every kernel.
+// Counters are read by perf_event_open, unavailable ones are printed as "-" (see Profiling::PerfCounters).
+//      Counters cover the calling thread only, so kernels run on it unless --parallel is given.
+//
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <limits>
+#include <functional>
+#include <exception>
+
+#include "perceptron.h"
+#include "math/matrix.h"
+#include "math/functions.h"
+#include "math/kernel_tuning.h"
+#include "math/random.h"
+#include "profiling/perf_counters.h"
+#include "profiling/tracer.h"
+
+using namespace NeuralNetwork;
+using namespace NeuralNetwork::Math;
+using namespace NeuralNetwork::Profiling;
+
+struct BenchmarkOptions
+{
+    int size = 512;
+    int repetitions = 5;
+    std::vector<int> layers = { 784, 512, 256, 10 };
+    int steps = 200;
+    bool isParallel = false;
+};
+
+struct Measurement
+{
+    double seconds;
+    PerfCounterValues counters;
+};
+
+//
+// Runs @body @repetitions times after a warm-up run, returns the fastest run.
+//
+Measurement Measure(PerfCounters& perfCounters, int repetitions, const std::function<void()>& body)
+{
+    body();
+
+    Measurement best = { std::numeric_limits<double>::max(), PerfCounterValues() };
+    for (int i = 0; i < repetitions; i++)
+    {
+        PerfCounterValues startCounters = perfCounters.Read();
+        auto start = std::chrono::steady_clock::now();
+        body();
+        auto end = std::chrono::steady_clock::now();
+        PerfCounterValues counters = perfCounters.Read() - startCounters;
+
+        double seconds = std::chrono::duration<double>(end - start).count();
+        if (seconds < best.seconds)
+            best = { seconds, counters };
+    }
+    return best;
+}
+
+void PrintHeader(const char* title)
+{
+    std::cout << std::endl << title << std::endl;
+    std::cout << std::left << std::setw(36) << "name" << std::right
+        << std::setw(12) << "time, us"
+        << std::setw(10) << "GFLOP/s"
+        << std::setw(10) << "GB/s"
+        << std::setw(8) << "IPC"
+        << std::setw(12) << "L1D miss"
+        << std::setw(12) << "LLC miss"
+        << std::setw(12) << "br miss"
+        << std::setw(12) << "FP ops"
+        << std::setw(10) << "faults" << std::endl;
+}
+
+void PrintCounter(const PerfCounterValues& counters, PerfCounter counter)
+{
+    std::cout << std::setw(12);
+    if (counters.IsAvailable(counter))
+        std::cout << counters.Get(counter);
+    else
+        std::cout << "-";
+}
+
+//
+// Params @flops and @bytes are per run, 0 when the kernel has no meaningful count.
+//
+void PrintRow(const std::string& name, double seconds, double flops, double bytes, const PerfCounterValues& counters)
+{
+    std::cout << std::left << std::setw(36) << name << std::right << std::fixed
+        << std::setw(12) << std::setprecision(1) << seconds * 1e6 << std::setprecision(2);
+
+    std::cout << std::setw(10);
+    if (flops > 0)
+        std::cout << flops / seconds * 1e-9;
+    else
+        std::cout << "-";
+
+    std::cout << std::setw(10);
+    if (bytes > 0)
+        std::cout << bytes / seconds * 1e-9;
+    else
+        std::cout << "-";
+
+    std::cout << std::setw(8);
+    if (counters.IsAvailable(PerfCounter::Cycles) && counters.IsAvailable(PerfCounter::Instructions))
+        std::cout << counters.GetInstructionsPerCycle();
+    else
+        std::cout << "-";
+
+    PrintCounter(counters, PerfCounter::L1DataMisses);
+    PrintCounter(counters, PerfCounter::LastLevelCacheMisses);
+    PrintCounter(counters, PerfCounter::BranchMisses);
+    PrintCounter(counters, PerfCounter::FloatingPointOperations);
+    std::cout << std::setw(10);
+    if (counters.IsAvailable(PerfCounter::PageFaults))
+        std::cout << counters.Get(PerfCounter::PageFaults);
+    else
+        std::cout << "-";
+    std::cout << std::defaultfloat << std::endl;
+}
+
+template<typename T>
+void BenchmarkKernels(const BenchmarkOptions& options, PerfCounters& perfCounters)
+{
+    int n = options.size;
+    double elements = static_cast<double>(n) * n;
+    double cube = elements * n;
+    double elementSize = sizeof(T);
+
+    Matrix<T> a(n, n, false);
+    Matrix<T> b(n, n, false);
+    Matrix<T> result(n, n, false);
+    // Factors close to one keep repeated products away from denormals
+    Matrix<T> factors(n, n, false);
+    Matrix<T> vector(n, 1, false);
+    Matrix<T> vectorResult(n, 1, false);
+    Random::FillUniform(a, 0, n, 1, 0, static_cast<T>(-1.0), static_cast<T>(1.0));
+    Random::FillUniform(b, 0, n, 1, 1, static_cast<T>(-1.0), static_cast<T>(1.0));
+    Random::FillUniform(vector, 0, n, 1, 2, static_cast<T>(-1.0), static_cast<T>(1.0));
+    Random::FillUniform(factors, 0, n, 1, 3, static_cast<T>(0.9), static_cast<T>(1.1));
+
+    std::ostringstream title;
+    title << "Kernels, " << n << " x " << n << (sizeof(T) == sizeof(double) ? " double" : " float");
+    PrintHeader(title.str().c_str());
+
+    struct Kernel
+    {
+        const char* name;
+        double flops;
+        double bytes;
+        std::function<void()> body;
+    };
+
+    std::vector<Kernel> kernels =
+    {
+        { "MultAndStoreThis", 2 * cube, 3 * elements * elementSize, [&]() { result.MultAndStoreThis(a, b); } },
+        { "MultTransposedToMatrixAndStoreTo", 2 * cube, 3 * elements * elementSize, [&]() { Matrix<T>::MultTransposedToMatrixAndStoreTo(a, b, result); } },
+        { "MultMatrixToTransposedAndStoreTo", 2 * cube, 3 * elements * elementSize, [&]() { Matrix<T>::MultMatrixToTransposedAndStoreTo(a, b, result); } },
+        { "MultAndStoreThis (GEMV)", 2 * elements, (elements + 2 * n) * elementSize, [&]() { vectorResult.MultAndStoreThis(a, vector); } },
+        { "ApplyFunction (Sigmoid)", 0, 2 * elements * elementSize, [&]() { result.ApplyFunction(Functions::Sigmoid); } },
+        { "HadamardProductThis", elements, 3 * elements * elementSize, [&]() { result.HadamardProductThis(factors); } },
+        { "operator+=", elements, 3 * elements * elementSize, [&]() { result += b; } }
+    };
+
+    for (const Kernel& kernel : kernels)
+    {
+        Measurement measurement = Measure(perfCounters, options.repetitions, kernel.body);
+        PrintRow(kernel.name, measurement.seconds, kernel.flops, kernel.bytes, measurement.counters);
+    }
+}
+
+//
+// Returns analytic flops and bytes of a perceptron span with @name for layer @index, zeros for other spans.
+//
+void GetLayerSpanCost(const std::vector<int>& layers, const std::string& name, int index, double elementSize, double& flops, double& bytes)
+{
+    flops = 0;
+    bytes = 0;
+    int layersCount = static_cast<int>(layers.size());
+    if (index < 0 || index + 1 >= layersCount)
+        return;
+
+    double weights = static_cast<double>(layers[index + 1]) * layers[index];
+    if (name == "GEMV")
+    {
+        flops = 2 * weights;
+        bytes = weights * elementSize;
+    }
+    else if (name == "WeightsGradient")
+    {
+        flops = weights;
+        bytes = weights * elementSize;
+    }
+    else if (name == "Delta" && index + 2 < layersCount)
+    {
+        double nextWeights = static_cast<double>(layers[index + 2]) * layers[index + 1];
+        flops = 2 * nextWeights;
+        bytes = nextWeights * elementSize;
+    }
+    else if (name == "AdjustWeights")
+    {
+        // Scaling of inertia and gradient, their sum, the step and its subtraction
+        flops = 5 * weights;
+        bytes = 10 * weights * elementSize;
+    }
+}
+
+template<typename T>
+void BenchmarkLayers(const BenchmarkOptions& options)
+{
+#ifdef _NN_TRACING
+    const std::vector<int>& layers = options.layers;
+    Perceptron<T> perceptron(layers);
+    perceptron.InitializeWeights(WeightsInitialization::XavierUniform, 1);
+    perceptron.InitTrainCache();
+
+    Matrix<T> input(layers.front(), 1, false);
+    Matrix<T> ideal(layers.back(), 1, false);
+    Random::FillUniform(input, 0, input.GetRows(), 2, 0, static_cast<T>(0.0), static_cast<T>(1.0));
+    Random::FillUniform(ideal, 0, ideal.GetRows(), 2, 1, static_cast<T>(-1.0), static_cast<T>(1.0));
+
+    auto step = [&]()
+    {
+        perceptron.SetInputValues(input);
+        perceptron.ForwardPropagationWithCache(Functions::HyperbolicTangent, Functions::HyperbolicTangentDerivative);
+        perceptron.BackwardPropagation(ideal, static_cast<T>(0.001), static_cast<T>(0.9));
+    };
+    step();
+
+    ClearTrace();
+    StartTracing(1 << 22, true);
+    for (int i = 0; i < options.steps; i++)
+    {
+        step();
+    }
+    StopTracing();
+
+    std::ostringstream title;
+    title << "Layers, " << options.steps << " steps, average per step";
+    PrintHeader(title.str().c_str());
+
+    for (const TraceSpanSummary& summary : GetTraceSummary())
+    {
+        if (summary.category != "forward" && summary.category != "backward")
+            continue;
+
+        double flops;
+        double bytes;
+        GetLayerSpanCost(layers, summary.name, summary.index, sizeof(T), flops, bytes);
+
+        // Spans run once per step, averages keep rows comparable with the kernels
+        PerfCounterValues counters = summary.counters;
+        for (std::uint64_t& value : counters.values)
+        {
+            value /= summary.count;
+        }
+
+        std::ostringstream name;
+        name << summary.category << " " << summary.name << " [" << summary.index << "]";
+        PrintRow(name.str(), summary.totalNanoseconds * 1e-9 / summary.count, flops, bytes, counters);
+    }
+#else
+    (void)options;
+    std::cout << std::endl << "Layers are not measured: build the library with ENABLE_TRACING" << std::endl;
+#endif
+}
+
+template<typename T>
+void Benchmark(const BenchmarkOptions& options)
+{
+    if (!options.isParallel)
+    {
+        KernelParameters parameters = GetKernelParameters();
+        parameters.multParallelThreshold = std::numeric_limits<long long>::max();
+        parameters.elementwiseParallelThreshold = std::numeric_limits<long long>::max();
+        SetKernelParameters(parameters);
+    }
+
+    PerfCounters perfCounters;
+    if (!perfCounters.IsAnyAvailable())
+        std::cout << "Performance counters are not available, check perf_event_paranoid" << std::endl;
+
+    BenchmarkKernels<T>(options, perfCounters);
+    BenchmarkLayers<T>(options);
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkOptions options;
+    bool isDouble = false;
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string argument = argv[i];
+            if (argument == "--double")
+                isDouble = true;
+            else if (argument == "--size" && i + 1 < argc)
+                options.size = std::stoi(argv[++i]);
+            else if (argument == "--repetitions" && i + 1 < argc)
+                options.repetitions = std::stoi(argv[++i]);
+            else if (argument == "--steps" && i + 1 < argc)
+                options.steps = std::stoi(argv[++i]);
+            else if (argument == "--layers" && i + 1 < argc)
+            {
+                options.layers.clear();
+                std::istringstream layersStream(argv[++i]);
+                for (std::string count; std::getline(layersStream, count, ',');)
+                {
+                    options.layers.push_back(std::stoi(count));
+                }
+            }
+            else if (argument == "--parallel")
+                options.isParallel = true;
+            else
+            {
+                std::cerr << "Unknown argument " << argument << std::endl;
+                return 1;
+            }
+        }
+
+        if (options.size < 1 || options.repetitions < 1 || options.steps < 1 || options.layers.size() < 2)
+        {
+            std::cerr << "Usage: " << argv[0] << " [--double] [--size <N>] [--repetitions <N>] [--layers <N>[,<N>...]] [--steps <N>] [--parallel]" << std::endl;
+            return 1;
+        }
+
+        if (isDouble)
+            Benchmark<double>(options);
+        else
+            Benchmark<float>(options);
+    }
+    catch (const std::exception& exception)
+    {
+        std::cerr << exception.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+//
+// Model compiler: emits a standalone C++ header with inference of a trained perceptron.
+// Usage:
+//      NeuralNetworkModelCompiler <state file> <output header> <namespace> <activation>[,<activation>...] [--double] [--unroll-limit <N>]
+// The state file is written by Perceptron::SaveState(). A single activation is used for all layers,
+//      otherwise one activation per layer except the input one is expected.
+// Activations: Linear, BinaryStep, Sigmoid, HyperbolicTangent, ReLU.
+//
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <exception>
+
+#include "perceptron.h"
+#include "compiler/model_compiler.h"
+
+using namespace NeuralNetwork;
+using namespace NeuralNetwork::Compiler;
+
+template<typename T>
+void Compile(const std::string& statePath, const std::string& outputPath, const std::string& namespaceName,
+    const std::vector<std::string>& activationNames, int unrollLimit)
+{
+    std::ifstream file(statePath, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Failed to open file " + statePath);
+
+    PerceptronState<T> state;
+    Perceptron<T>::ReadState(file, state);
+    Perceptron<T> perceptron(state.neuronsCountPerLayer);
+    perceptron.SetState(state);
+
+    std::vector<Activation> activations;
+    for (const std::string& name : activationNames)
+    {
+        activations.push_back(ModelCompiler<T>::ParseActivation(name));
+    }
+    if (activations.size() == 1)
+        activations.resize(state.neuronsCountPerLayer.size() - 1, activations[0]);
+
+    ModelCompiler<T> compiler(perceptron, activations, unrollLimit);
+    compiler.EmitToFile(outputPath, namespaceName);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 5)
+    {
+        std::cerr << "Usage: " << argv[0] << " <state file> <output header> <namespace> <activation>[,<activation>...] [--double] [--unroll-limit <N>]" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> activationNames;
+    std::istringstream activationsStream(argv[4]);
+    for (std::string name; std::getline(activationsStream, name, ',');)
+    {
+        activationNames.push_back(name);
+    }
+
+    bool isDouble = false;
+    int unrollLimit = 4096;
+    for (int i = 5; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--double")
+            isDouble = true;
+        else if (argument == "--unroll-limit" && i + 1 < argc)
+            unrollLimit = std::stoi(argv[++i]);
+        else
+        {
+            std::cerr << "Unknown argument " << argument << std::endl;
+            return 1;
+        }
+    }
+
+    try
+    {
+        if (isDouble)
+            Compile<double>(argv[1], argv[2], argv[3], activationNames, unrollLimit);
+        else
+            Compile<float>(argv[1], argv[2], argv[3], activationNames, unrollLimit);
+    }
+    catch (const std::exception& exception)
+    {
+        std::cerr << exception.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file